@@ -0,0 +1,106 @@
+#ifndef __ALLOC_H
+#define __ALLOC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Allocation layer used by all modules. Every allocation is tagged with
+ * the subsystem that made it.
+ *
+ * Tracking is opt-in: compile with -DALLOC_TRACK to keep live bytes,
+ * peak bytes and allocation count per tag, and to make alloc_report()
+ * print them. Without ALLOC_TRACK the functions below are plain macros
+ * around calloc(), malloc(), realloc() and free() and cost nothing.
+ *
+ * Memory returned by this layer must be released with alloc_free(),
+ * never with free(), since tracked blocks carry a hidden header.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef enum alloc_tag {
+    ALLOC_ARRAY,   // array_1d and array_2d
+    ALLOC_LIST,    // list
+    ALLOC_DLIST,   // dlist
+    ALLOC_QUEUE,   // queue
+    ALLOC_GRAPH,   // graph nodes and heads
+    ALLOC_LOADER,  // map file lines and city names
+    ALLOC_STATS,   // latency histograms
+    ALLOC_SERVER,  // server connections and requests
+    ALLOC_TAG_COUNT
+} alloc_tag;
+
+// =================== ALLOCATION INTERFACE ======================
+
+#ifdef ALLOC_TRACK
+
+/**
+ * alloc_calloc() - Allocate zeroed memory for n elements.
+ * @tag: Subsystem making the allocation.
+ * @n: Number of elements.
+ * @size: Size of each element.
+ *
+ * Returns: A pointer to the memory, or NULL if none was available.
+ */
+void *alloc_calloc(alloc_tag tag, size_t n, size_t size);
+
+/**
+ * alloc_malloc() - Allocate uninitialized memory.
+ * @tag: Subsystem making the allocation.
+ * @size: Number of bytes.
+ *
+ * Returns: A pointer to the memory, or NULL if none was available.
+ */
+void *alloc_malloc(alloc_tag tag, size_t size);
+
+/**
+ * alloc_realloc() - Change the size of an allocation.
+ * @tag: Subsystem making the allocation.
+ * @p: Memory from this layer, or NULL.
+ * @size: New number of bytes.
+ *
+ * Returns: A pointer to the memory, or NULL if none was available in
+ * which case p is left untouched.
+ */
+void *alloc_realloc(alloc_tag tag, void *p, size_t size);
+
+/**
+ * alloc_free() - Return memory allocated by this layer.
+ * @p: Memory to free, or NULL.
+ *
+ * Returns: Nothing.
+ */
+void alloc_free(void *p);
+
+/**
+ * alloc_report() - Print live bytes, peak bytes and count per tag.
+ * @out: Stream to print to.
+ * @checkpoint: Name of the point in the program being reported.
+ *
+ * Returns: Nothing.
+ */
+void alloc_report(FILE *out, const char *checkpoint);
+
+#else
+
+#define alloc_calloc(tag, n, size) calloc((n), (size))
+#define alloc_malloc(tag, size) malloc(size)
+#define alloc_realloc(tag, p, size) realloc((p), (size))
+#define alloc_free(p) free(p)
+#define alloc_report(out, checkpoint) ((void)0)
+
+#endif
+
+/**
+ * check() - Abort if an allocation failed.
+ * @p: Pointer returned by one of the functions above.
+ *
+ * Prints "Unable to allocate memory." and exits the program if p is
+ * NULL.
+ *
+ * Returns: p.
+ */
+void *check(void *p);
+
+#endif
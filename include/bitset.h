@@ -0,0 +1,93 @@
+#ifndef __BITSET_H
+#define __BITSET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Dense set of small integers, one bit each, used as the visited set of
+ * the searches. A million nodes take 128 kB, which stays in the cache
+ * where a flag in each node would not.
+ *
+ * Testing and setting are inline, since a search does one for every
+ * edge it follows.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+// The fields are only public for the inline functions below.
+typedef struct bitset {
+    uint64_t *words;
+    size_t numWords;
+} bitset;
+
+// =================== BITSET INTERFACE ======================
+
+/**
+ * bitset_empty() - Create an empty set.
+ *
+ * Returns: A pointer to the new set.
+ */
+bitset *bitset_empty(void);
+
+/**
+ * bitset_clear() - Remove all members and make room for more.
+ * @b: Set to clear.
+ * @bits: Number of bits that will be used, 0 to bits-1.
+ *
+ * Whole words are cleared at a time, only as many as the bits need.
+ *
+ * Returns: Nothing.
+ */
+void bitset_clear(bitset *b, size_t bits);
+
+/**
+ * bitset_kill() - Destroy a set.
+ * @b: Set to destroy, or NULL.
+ *
+ * Returns: Nothing.
+ */
+void bitset_kill(bitset *b);
+
+/**
+ * bitset_test() - Check if a number is in the set.
+ * @b: Set to inspect.
+ * @i: Number to look for, below the bits given to bitset_clear().
+ *
+ * Returns: True if i is in the set.
+ */
+static inline bool bitset_test(const bitset *b, size_t i)
+{
+    return (b->words[i >> 6] >> (i & 63)) & 1;
+}
+
+/**
+ * bitset_test_and_set() - Add a number to the set.
+ * @b: Set to modify.
+ * @i: Number to add, below the bits given to bitset_clear().
+ *
+ * Returns: True if i was already in the set.
+ */
+static inline bool bitset_test_and_set(bitset *b, size_t i)
+{
+    uint64_t bit = (uint64_t)1 << (i & 63);
+    uint64_t *w = &b->words[i >> 6];
+    bool was = (*w & bit) != 0;
+    *w |= bit;
+    return was;
+}
+
+/**
+ * bitset_unset() - Remove a number from the set.
+ * @b: Set to modify.
+ * @i: Number to remove, below the bits given to bitset_clear().
+ *
+ * Returns: Nothing.
+ */
+static inline void bitset_unset(bitset *b, size_t i)
+{
+    b->words[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+#endif
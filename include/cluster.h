@@ -0,0 +1,117 @@
+#ifndef __CLUSTER_H
+#define __CLUSTER_H
+
+#include <stdbool.h>
+
+#include "source.h"
+#include "stats.h"
+
+/*
+ * Sharded reachability search over worker processes on the same host.
+ *
+ * The nodes are split into K parts and each part, with the edges leaving
+ * its nodes, is handed to its own worker process. The workers are
+ * forked before the map is loaded, so each of them only ever holds its
+ * own shard. The coordinating process keeps the names and which shard
+ * owns each node. It never builds the graph: the edges go to a
+ * temporary file as the map is read, and the shards are built from
+ * there one at a time. Only the partitioner holds every edge, in both
+ * directions, as a plain array of node indices.
+ *
+ * The partitioner grows one part at a time until it has its share of
+ * the nodes and edges, always adding the node with the most edges into
+ * the part, in either direction. It then moves single nodes to the part
+ * holding most of their neighbours as long as that lowers the number of
+ * cut edges and keeps the parts balanced.
+ *
+ * A search runs in rounds. In each round every worker that has been
+ * given nodes searches as far as its own edges reach and reports the
+ * nodes of other shards that it found. The coordinator drops the nodes
+ * that were already reached and sends the rest to their owners for the
+ * next round, over the pipes to the workers. The search ends when the
+ * destination is reached or a round finds nothing new, and gives the
+ * same answers as find_path().
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct cluster cluster;
+
+// =================== CLUSTER INTERFACE ======================
+
+/**
+ * cluster_start() - Start the worker processes.
+ * @shards: Number of shards, and so of workers.
+ *
+ * Call this before the graph is loaded so that the workers do not share
+ * its pages with the coordinator.
+ *
+ * Returns: A pointer to the new cluster, or NULL after printing an
+ * error message if the workers could not be started.
+ */
+cluster *cluster_start(int shards);
+
+/**
+ * cluster_load() - Read a map, partition it and hand out the shards.
+ * @c: Started cluster.
+ * @src: Source of the map bytes. Not closed.
+ * @showStats: If true, print the size of the cut and of each shard.
+ *
+ * The edges are spilled to a temporary file as they are read, and no
+ * graph is built. The partitioner then needs both directions of every
+ * edge in memory. Each shard is built and sent in turn from its own
+ * spill file, so only one shard is held at a time.
+ *
+ * Returns: True if the shards were sent, or false after printing an
+ * error message if the map is badly formatted or could not be spilled.
+ */
+bool cluster_load(cluster *c, source *src, bool showStats);
+
+/**
+ * cluster_node_count() - Return the number of nodes.
+ * @c: Loaded cluster.
+ *
+ * Returns: The number of nodes.
+ */
+int cluster_node_count(const cluster *c);
+
+/**
+ * cluster_edge_count() - Return the number of edges read from the map.
+ * @c: Loaded cluster.
+ *
+ * Returns: The number of edges.
+ */
+int cluster_edge_count(const cluster *c);
+
+/**
+ * cluster_lookup() - Find a node by its name.
+ * @c: Loaded cluster.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the node, or -1 if there is no such city.
+ */
+int cluster_lookup(const cluster *c, const char *name);
+
+/**
+ * cluster_find_path() - Check for a path between two nodes.
+ * @c: Loaded cluster.
+ * @from: Index of the origin node.
+ * @to: Index of the destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The frontier peak counts the nodes passed between shards in a round.
+ * If stats is given it is overwritten with the cost of this search.
+ *
+ * Returns: True if a path exists from the origin to the destination.
+ */
+bool cluster_find_path(cluster *c, int from, int to, search_stats *stats);
+
+/**
+ * cluster_stop() - Stop the workers and destroy the cluster.
+ * @c: Cluster to destroy.
+ *
+ * Returns: Nothing.
+ */
+void cluster_stop(cluster *c);
+
+#endif
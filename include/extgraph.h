@@ -0,0 +1,101 @@
+#ifndef __EXTGRAPH_H
+#define __EXTGRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "source.h"
+#include "stats.h"
+
+/*
+ * External memory graph for maps whose edges do not fit in memory.
+ *
+ * The edges are sorted on disk into an adjacency file with one record
+ * per city that has neighbours, in node order:
+ *
+ *   varint  node index minus the index of the previous record,
+ *   varint  first neighbour plus one,
+ *   varint  each further neighbour minus the previous one, ascending,
+ *   varint  0, ending the record.
+ *
+ * A search runs breadth first one level at a time. The frontier is a
+ * sorted run of node indices, so expanding a level is a single
+ * sequential scan of the adjacency file merged with the frontier. The
+ * next frontier is collected and sorted the same way, spilling sorted
+ * runs to disk when it outgrows its buffer, and the runs are merged
+ * with sequential reads only.
+ *
+ * The memory budget bounds the sort buffers and the file buffers. The
+ * city names and one visited bit per city are kept in memory on top of
+ * the budget. All files are created in the given directory and are
+ * removed as soon as they are opened, so nothing is left behind.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct extgraph extgraph;
+
+// =================== EXTERNAL GRAPH INTERFACE ======================
+
+/**
+ * extgraph_build() - Sort a map into an external memory graph.
+ * @src: Source of the map bytes. Not closed.
+ * @dir: Directory for the adjacency and temporary files.
+ * @budget: Bytes of memory to use for buffers.
+ *
+ * Lines are handled by the same rules as when the map is loaded into
+ * memory. Duplicate edges are kept only once.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted or a file could not be used.
+ */
+extgraph *extgraph_build(source *src, const char *dir, size_t budget);
+
+/**
+ * extgraph_node_count() - Return the number of nodes.
+ * @eg: Graph to inspect.
+ *
+ * Returns: The number of nodes.
+ */
+int extgraph_node_count(const extgraph *eg);
+
+/**
+ * extgraph_edge_count() - Return the number of edges read from the map.
+ * @eg: Graph to inspect.
+ *
+ * Returns: The number of edges.
+ */
+int extgraph_edge_count(const extgraph *eg);
+
+/**
+ * extgraph_lookup() - Find a node by its name.
+ * @eg: Graph to inspect.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the node, or -1 if there is no such city.
+ */
+int extgraph_lookup(const extgraph *eg, const char *name);
+
+/**
+ * extgraph_find_path() - Check for a path between two nodes.
+ * @eg: Graph to search.
+ * @from: Index of the origin node.
+ * @to: Index of the destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The search stops as soon as the destination is reached. If stats is
+ * given it is overwritten with the cost of this search.
+ *
+ * Returns: True if a path exists from the origin to the destination.
+ */
+bool extgraph_find_path(extgraph *eg, int from, int to, search_stats *stats);
+
+/**
+ * extgraph_kill() - Destroy a graph and close its files.
+ * @eg: Graph to destroy.
+ *
+ * Returns: Nothing.
+ */
+void extgraph_kill(extgraph *eg);
+
+#endif
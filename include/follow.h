@@ -0,0 +1,58 @@
+#ifndef __FOLLOW_H
+#define __FOLLOW_H
+
+#include <stdio.h>
+
+#include "loader.h"
+
+/*
+ * Tail-follow of a map file that is appended to while the program runs.
+ * The follower remembers how far the file has been loaded and, when
+ * asked, parses only the lines appended since then. Changes are noticed
+ * with inotify, or by comparing the file size where inotify is not
+ * available.
+ *
+ * Only complete lines are parsed. A line still being written is kept
+ * until its newline arrives. The lines are handled by the same rules as
+ * when the map is loaded, and a badly formatted line is reported and
+ * skipped instead of ending the program.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct follower follower;
+
+// =================== FOLLOW INTERFACE ======================
+
+/**
+ * follow_start() - Start following a loaded map file.
+ * @in: The map file, positioned after the bytes that have been loaded.
+ * @file: Name of the map file, for inotify.
+ *
+ * Returns: A pointer to the new follower, or NULL after printing an
+ * error message if the file is not a regular file.
+ */
+follower *follow_start(FILE *in, const char *file);
+
+/**
+ * follow_poll() - Parse the lines appended since the last call.
+ * @f: Follower to poll.
+ * @cb: Function called with the two city names of each new edge.
+ * @ctx: Passed on to cb.
+ *
+ * Cheap when nothing has changed: one non-blocking read from inotify,
+ * or one fstat() in the polling fallback.
+ *
+ * Returns: The number of edges passed to cb.
+ */
+int follow_poll(follower *f, edge_callback cb, void *ctx);
+
+/**
+ * follow_stop() - Stop following. The map file is not closed.
+ * @f: Follower to destroy.
+ *
+ * Returns: Nothing.
+ */
+void follow_stop(follower *f);
+
+#endif
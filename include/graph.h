@@ -2,8 +2,12 @@
 #define __GRAPH_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "util.h"
 #include "dlist.h"
+#include "array_2d.h"
+#include "bitset.h"
 
 /*
  * Declaration of a generic graph for the "Datastructures and
@@ -36,6 +40,51 @@
 typedef struct node node;
 typedef struct graph graph;
 
+// Width of the node IDs in bits, 16, 32 or 64. The neighbour lists
+// store one ID per edge, so a narrower ID saves memory on graphs that
+// fit in it. Chosen at compile time with -DGRAPH_ID_BITS=n.
+#ifndef GRAPH_ID_BITS
+#define GRAPH_ID_BITS 32
+#endif
+
+#if GRAPH_ID_BITS == 16
+typedef uint16_t graph_id;
+#elif GRAPH_ID_BITS == 32
+typedef uint32_t graph_id;
+#elif GRAPH_ID_BITS == 64
+typedef uint64_t graph_id;
+#else
+#error "GRAPH_ID_BITS must be 16, 32 or 64"
+#endif
+
+// Lowest number of edges per pair of nodes at which
+// graph_choose_matrix() keeps the edges in a bit matrix. At one edge in
+// GRAPH_ID_BITS pairs the matrix takes as much memory as the neighbour
+// lists. Chosen at compile time with -DGRAPH_MATRIX_DENSITY=x.
+#ifndef GRAPH_MATRIX_DENSITY
+#define GRAPH_MATRIX_DENSITY (1.0 / GRAPH_ID_BITS)
+#endif
+
+// Position in the neighbours of a node, see graph_neighbours_begin().
+// The fields belong to the graph and must not be used directly.
+typedef struct neighbour_iter {
+    bool packed;
+    bool matrix;
+    const array_2d *rows;
+    int row;
+    int word;
+    int words;
+    uintptr_t bits;
+    bitset *seen;
+    unsigned long scanned;
+    const graph_id *ids;
+    const graph_id *idsEnd;
+    const unsigned char *next;
+    const unsigned char *end;
+    graph_id last;
+    bool first;
+} neighbour_iter;
+
 // =================== NODE COMPARISON FUNCTION ======================
 
 /**
@@ -52,7 +101,8 @@ bool nodes_are_equal(const node *n1,const node *n2);
 
 /**
  * graph_empty() - Create an empty graph.
- * @max_nodes: The maximum number of nodes the graph can hold.
+ * @max_nodes: The number of nodes to make room for. The graph grows
+ *             when more nodes are inserted.
  *
  * Returns: A pointer to the new graph.
  */
@@ -80,7 +130,7 @@ bool graph_has_edges(const graph *g);
  * @s: Node name.
  *
  * Creates a new node with a copy of the given name and puts it into
- * the graph.
+ * the graph. Exits with an error message if there are no node IDs left.
  *
  * Returns: The modified graph.
  */
@@ -95,6 +145,58 @@ graph *graph_insert_node(graph *g, const char *s);
  */
 node *graph_find_node(const graph *g, const char *s);
 
+/**
+ * graph_get_node() - Return the node stored at a given index.
+ * @g: Graph to inspect.
+ * @index: Index of the node, 0 for the first inserted node.
+ *
+ * NOTE: Undefined unless index is below the number of inserted nodes.
+ *
+ * Returns: A pointer to the node.
+ */
+node *graph_get_node(const graph *g, int index);
+
+/**
+ * graph_node_count() - Return the number of inserted nodes.
+ * @g: Graph to inspect.
+ *
+ * Returns: The number of nodes inserted so far.
+ */
+int graph_node_count(const graph *g);
+
+/**
+ * graph_node_index() - Return the index of a node.
+ * @g: Graph storing the node.
+ * @n: Node in the graph.
+ *
+ * The index is the insertion order of the node, and is what
+ * graph_get_node() takes.
+ *
+ * Returns: The index of the node.
+ */
+int graph_node_index(const graph *g, const node *n);
+
+/**
+ * graph_node_id() - Return the ID of a node.
+ * @g: Graph storing the node.
+ * @n: Node in the graph.
+ *
+ * The ID has the same value as the index, in the GRAPH_ID_BITS wide
+ * type that the neighbour lists are stored with.
+ *
+ * Returns: The ID of the node.
+ */
+graph_id graph_node_id(const graph *g, const node *n);
+
+/**
+ * graph_node_name() - Return the name of a node.
+ * @g: Graph storing the node.
+ * @n: Node in the graph.
+ *
+ * Returns: The name the node was inserted with.
+ */
+const char *graph_node_name(const graph *g, const node *n);
+
 /**
  * graph_node_is_seen() - Return the seen status for a node.
  * @g: Graph storing the node.
@@ -128,7 +230,8 @@ graph *graph_reset_seen(graph *g);
  * @n1: Source node (pointer) for the edge.
  * @n2: Destination node (pointer) for the edge.
  *
- * NOTE: Undefined unless both nodes are already in the graph.
+ * NOTE: Undefined unless both nodes are already in the graph. Also
+ * undefined after graph_compact() or graph_choose_matrix().
  *
  * Returns: The modified graph.
  */
@@ -177,6 +280,211 @@ node *graph_choose_node(const graph *g);
  */
 dlist *graph_neighbours(const graph *g,const node *n);
 
+/**
+ * graph_remove_duplicates() - Remove repeated edges and self-loops.
+ * @g: Graph to modify. Must not be compact or a matrix.
+ *
+ * Neither kind of edge changes which nodes can be reached, but both
+ * are followed on every search. Each neighbour list is left sorted.
+ *
+ * Returns: The number of edges removed.
+ */
+int graph_remove_duplicates(graph *g);
+
+/**
+ * graph_renumber() - Give every node a new index.
+ * @g: Graph to renumber. Must not be compact or a matrix.
+ * @newIndex: newIndex[i] is the new index of the node now at index i.
+ *             Must be a permutation of 0 to the node count minus one.
+ *
+ * Neighbour lists are rewritten to the new indices. Names and nodes
+ * stay the same, so graph_find_node() finds the same node as before.
+ *
+ * Returns: The modified graph.
+ */
+graph *graph_renumber(graph *g, const int *newIndex);
+
+/**
+ * graph_neighbours_begin() - Start going through the neighbours of a node.
+ * @g: Graph to inspect.
+ * @n: Node to get neighbours for.
+ * @it: Iterator to set up.
+ *
+ * Unlike graph_neighbours() nothing is allocated. The neighbours are
+ * returned by graph_neighbours_next(), in ascending ID order if the
+ * graph is compact. The graph must not be modified meanwhile.
+ *
+ * Returns: Nothing.
+ */
+void graph_neighbours_begin(const graph *g, const node *n, neighbour_iter *it);
+
+/**
+ * graph_neighbours_next() - Return the next neighbour of a node.
+ * @g: Graph to inspect.
+ * @it: Iterator set up by graph_neighbours_begin().
+ * @id: Set to the ID of the neighbour.
+ *
+ * Returns: True if there was another neighbour, false when done.
+ */
+bool graph_neighbours_next(const graph *g, neighbour_iter *it, graph_id *id);
+
+/**
+ * graph_unseen_neighbours_begin() - Start going through the neighbours
+ *                                   of a node that are not yet seen.
+ * @g: Graph to inspect.
+ * @n: Node to get neighbours for.
+ * @seen: Visited set, sized to the graph.
+ * @it: Iterator to set up.
+ *
+ * Works like graph_neighbours_begin(), but graph_neighbours_next() skips
+ * the neighbours in seen and adds each neighbour it returns. A matrix
+ * graph skips the seen neighbours a word at a time.
+ *
+ * Returns: Nothing.
+ */
+void graph_unseen_neighbours_begin(const graph *g, const node *n, bitset *seen,
+                                   neighbour_iter *it);
+
+/**
+ * graph_neighbours_scanned() - Return how many neighbours were looked at.
+ * @it: Iterator set up by graph_unseen_neighbours_begin().
+ *
+ * Returns: The number of neighbours passed so far, seen or not.
+ */
+unsigned long graph_neighbours_scanned(const neighbour_iter *it);
+
+/**
+ * graph_keep_in_edges() - Keep the in-edges of every node from now on.
+ * @g: Graph to modify. Must not be compact or a matrix.
+ *
+ * The in-edges of the edges already inserted are collected at once,
+ * later ones as they are inserted. Each in-edge takes as much memory
+ * as an out-edge.
+ *
+ * Returns: The modified graph.
+ */
+graph *graph_keep_in_edges(graph *g);
+
+/**
+ * graph_has_in_edges() - Check if a graph keeps in-edges.
+ * @g: Graph to check.
+ *
+ * Returns: True after graph_keep_in_edges(), otherwise false.
+ */
+bool graph_has_in_edges(const graph *g);
+
+/**
+ * graph_in_neighbours_begin() - Start going through the nodes with an
+ *                               edge to a node.
+ * @g: Graph to inspect. Must keep in-edges.
+ * @n: Node to get in-neighbours for.
+ * @it: Iterator to set up.
+ *
+ * Works like graph_neighbours_begin(), the nodes are returned by
+ * graph_neighbours_next().
+ *
+ * Returns: Nothing.
+ */
+void graph_in_neighbours_begin(const graph *g, const node *n, neighbour_iter *it);
+
+/**
+ * graph_compact() - Pack all neighbour lists into a read-only format.
+ * @g: Graph to pack.
+ *
+ * Each neighbour list is sorted and stored as varints in one shared
+ * byte array: the first neighbour relative to the node, each further
+ * one as the gap from the previous. Usually one or two bytes per edge
+ * instead of a full ID. Nodes and edges must not be inserted
+ * afterwards, everything else works as before.
+ *
+ * Returns: The modified graph.
+ */
+graph *graph_compact(graph *g);
+
+/**
+ * graph_choose_matrix() - Keep the edges in a bit matrix if it pays off.
+ * @g: Graph to convert. Must not be compact.
+ *
+ * If there are at least GRAPH_MATRIX_DENSITY edges per pair of nodes,
+ * the neighbour lists are replaced by an array_2d with one bit per pair
+ * of nodes, packed into pointer sized words. The neighbours of a node
+ * are then read a word at a time, in ascending ID order. Nodes and
+ * edges must not be inserted afterwards, everything else works as
+ * before.
+ *
+ * Returns: True if the graph was converted, otherwise false.
+ */
+bool graph_choose_matrix(graph *g);
+
+/**
+ * graph_is_matrix() - Check if graph_choose_matrix() has converted a graph.
+ * @g: Graph to check.
+ *
+ * Returns: True if the edges are kept in a bit matrix, otherwise false.
+ */
+bool graph_is_matrix(const graph *g);
+
+/**
+ * graph_is_compact() - Check if graph_compact() has packed a graph.
+ * @g: Graph to check.
+ *
+ * Returns: True if the graph is compact, otherwise false.
+ */
+bool graph_is_compact(const graph *g);
+
+/**
+ * graph_edge_bytes() - Return the bytes holding the packed neighbours.
+ * @g: Compact or matrix graph to inspect.
+ *
+ * Returns: The size of the packed neighbour lists or of the matrix,
+ * in-edges included, not counting the offset of each node.
+ */
+size_t graph_edge_bytes(const graph *g);
+
+/**
+ * graph_label_components() - Label the weakly connected components.
+ * @g: Graph to label.
+ *
+ * Every edge is taken to run both ways and the nodes are joined with a
+ * union-find, so a node can only reach nodes with the same label. The
+ * labels are numbered from 0 in the order of the first node of each
+ * component. They are dropped when a node is inserted, or an edge
+ * between two components, until the graph is labelled again.
+ *
+ * Returns: The number of components.
+ */
+int graph_label_components(graph *g);
+
+/**
+ * graph_component_count() - Return the number of labelled components.
+ * @g: Graph to inspect.
+ *
+ * Returns: The number of components, or 0 if the graph is not labelled.
+ */
+int graph_component_count(const graph *g);
+
+/**
+ * graph_component_size() - Return the number of nodes in a component.
+ * @g: Labelled graph to inspect.
+ * @label: Label of the component.
+ *
+ * Returns: The number of nodes with the label.
+ */
+int graph_component_size(const graph *g, int label);
+
+/**
+ * graph_may_reach() - Check if a path between two nodes is possible.
+ * @g: Graph storing the nodes.
+ * @n1: Origin node.
+ * @n2: Destination node.
+ *
+ * Answers in constant time, without a search.
+ *
+ * Returns: False if the graph is labelled and the nodes are in different
+ * components, otherwise true.
+ */
+bool graph_may_reach(const graph *g, const node *n1, const node *n2);
+
 /**
  * graph_kill() - Destroy a given graph.
  * @g: Graph to destroy.
@@ -0,0 +1,100 @@
+#ifndef __HISTOGRAM_H
+#define __HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Log-bucketed latency histogram in the style of HdrHistogram. Values
+ * are recorded in nanoseconds. Every power of two is split into
+ * HISTOGRAM_SUB_COUNT linear sub-buckets, so any recorded value is
+ * reported with a relative error below 1/HISTOGRAM_SUB_COUNT while the
+ * whole 64-bit range fits in a fixed number of counters.
+ *
+ * Histograms can be written to a text dump and read back. Reading a
+ * dump adds its counts to an existing histogram, so dumps from several
+ * runs can be merged before the percentiles are computed.
+ */
+
+#define HISTOGRAM_SUB_BITS 7
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct histogram {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;  // Number of recorded values.
+    uint64_t min;    // Smallest recorded value.
+    uint64_t max;    // Largest recorded value.
+} histogram;
+
+// =================== HISTOGRAM INTERFACE ======================
+
+/**
+ * histogram_empty() - Create an empty histogram.
+ *
+ * Returns: A pointer to the new histogram. Must be alloc_free()-d after use.
+ */
+histogram *histogram_empty(void);
+
+/**
+ * histogram_record() - Record one value.
+ * @h: Histogram to update.
+ * @value: Value to record, in nanoseconds.
+ *
+ * Returns: Nothing.
+ */
+void histogram_record(histogram *h, uint64_t value);
+
+/**
+ * histogram_percentile() - Return the value at a given percentile.
+ * @h: Histogram to inspect.
+ * @p: Percentile, 0 to 100.
+ *
+ * Returns: The highest value equivalent to the bucket holding the
+ * percentile, capped at the recorded maximum, or 0 if h is empty.
+ */
+uint64_t histogram_percentile(const histogram *h, double p);
+
+/**
+ * histogram_merge() - Add all counts of one histogram to another.
+ * @h: Histogram to update.
+ * @other: Histogram to add.
+ *
+ * Returns: Nothing.
+ */
+void histogram_merge(histogram *h, const histogram *other);
+
+/**
+ * histogram_report() - Print count, p50, p90, p99, p99.9 and max.
+ * @out: Stream to print to.
+ * @label: Text printed in front of the report.
+ * @h: Histogram to report.
+ *
+ * Returns: Nothing.
+ */
+void histogram_report(FILE *out, const char *label, const histogram *h);
+
+/**
+ * histogram_write() - Write a histogram dump.
+ * @out: Stream to write to.
+ * @h: Histogram to dump.
+ *
+ * Only non-empty buckets are written, one "index count" pair per line.
+ *
+ * Returns: Nothing.
+ */
+void histogram_write(FILE *out, const histogram *h);
+
+/**
+ * histogram_read() - Read a histogram dump and merge it into h.
+ * @in: Stream to read from.
+ * @h: Histogram to update.
+ *
+ * Returns: True if the dump was read, false if it was malformed.
+ */
+bool histogram_read(FILE *in, histogram *h);
+
+#endif
@@ -1,5 +1,5 @@
-#ifndef __ARRAY_1D_H
-#define __ARRAY_1D_H
+#ifndef __INT_ARRAY_1D_H
+#define __INT_ARRAY_1D_H
 
 #include <stdbool.h>
 #include "util.h"
@@ -89,9 +89,6 @@ void int_array_1d_set_value(int_array_1d *a, int v, int i);
  * int_array_1d_kill() - Return memory allocated by array.
  * @a: array to kill.
  * 
- * Iterates over all elements. If free_func was specified at array
- * creation, calls it for every non-NULL element value.
- *
  * Returns: Nothing.
  */
 void int_array_1d_kill(int_array_1d *a);
@@ -0,0 +1,126 @@
+#ifndef __LOADER_H
+#define __LOADER_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "list.h"
+#include "graph.h"
+#include "source.h"
+
+/*
+ * Parallel map loader. The map file is split into newline-aligned
+ * chunks which are tokenized on all cores, each thread interning city
+ * names in its own table. The tables are then merged in file order and
+ * the edges are grouped by source with a parallel counting sort before
+ * they are inserted into the graph.
+ *
+ * The result is identical to the sequential loader: nodes get the same
+ * indices, neighbour lists the same order, and lines are split, skipped
+ * and cut at '#' by the same rules, including the BUFSIZE limit of the
+ * fgets() based reader the map format was first defined by.
+ */
+
+// Size of the line buffer of the sequential reader. Longer lines are
+// handled as several lines of at most BUFSIZE-1 characters.
+#define BUFSIZE 300
+
+// Called for each edge found in a map, with the two city names. The
+// names are not '\0'-terminated.
+typedef void (*edge_callback)(void *ctx, const char *a, int alen,
+                              const char *b, int blen);
+
+/**
+ * map_scan_lines() - Find the edges in a range of map file lines.
+ * @begin: Start of the first line.
+ * @end: End of the range, just after a newline or at the end of file.
+ * @cb: Function called with the two city names of each edge.
+ * @ctx: Passed on to cb.
+ *
+ * Lines are split, skipped and cut by the rules of the sequential
+ * reader described above.
+ *
+ * Returns: True if all lines were well formed, otherwise false.
+ */
+bool map_scan_lines(const char *begin, const char *end, edge_callback cb, void *ctx);
+
+// Start of a line split between two blocks of a map. Freed with
+// alloc_free(buf).
+typedef struct carry {
+    char *buf;
+    size_t len;
+    size_t cap;
+} carry;
+
+/**
+ * carry_append() - Append bytes to a carried partial line.
+ * @c: Partial line, zero-initialized before the first call.
+ * @s: Bytes to append.
+ * @len: Number of bytes, may be 0.
+ *
+ * Returns: Nothing.
+ */
+void carry_append(carry *c, const char *s, size_t len);
+
+/**
+ * map_scan_source() - Find the edges of a whole map read from a source.
+ * @src: Source of the map bytes. Not closed.
+ * @blockSize: Number of bytes to read at a time.
+ * @cb: Function called with the two city names of each edge.
+ * @ctx: Passed on to cb.
+ *
+ * Lines split between two reads are joined first, so the edges are the
+ * same as map_scan_lines() finds in the whole map at once. Prints an
+ * error message for a badly formatted map.
+ *
+ * Returns: True if the map was read and well formed, otherwise false.
+ */
+bool map_scan_source(source *src, size_t blockSize, edge_callback cb, void *ctx);
+
+/**
+ * map_is_undirected() - Check if a map says that its routes run both ways.
+ * @src: Source of the map, not read from yet.
+ *
+ * An undirected map has "# undirected" as its first line, with any
+ * white-space around the word. The line is peeked at, so piped and
+ * compressed maps are recognized too and are still read from the start.
+ *
+ * Returns: True if the map is marked as undirected, otherwise false.
+ */
+bool map_is_undirected(source *src);
+
+/**
+ * load_map_sequential() - Build a graph from a map on the calling thread.
+ * @src: Source of the map bytes. Not closed.
+ * @cities: Empty list that receives the city names in node order.
+ * @numCities: Set to the number of cities, i.e. nodes.
+ * @numEdges: Set to the number of edges inserted.
+ *
+ * The map is read a block at a time and split by map_scan_source(). A
+ * city gets its node the first time it is seen. The names in cities
+ * are owned by the caller and must be alloc_free()-d after the graph
+ * is killed.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted.
+ */
+graph *load_map_sequential(source *src, list *cities, int *numCities, int *numEdges);
+
+/**
+ * load_map_parallel() - Build a graph from a map file using threads.
+ * @in: Map file opened for reading.
+ * @threads: Number of threads to use, or 0 for one per core.
+ * @cities: Empty list that receives the city names in node order.
+ * @numCities: Set to the number of cities, i.e. nodes.
+ * @numEdges: Set to the number of edges inserted.
+ *
+ * The names in cities are owned by the caller and must be
+ * alloc_free()-d after the graph is killed.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted.
+ */
+graph *load_map_parallel(FILE *in, int threads, list *cities, int *numCities,
+                         int *numEdges);
+
+#endif
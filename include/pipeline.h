@@ -0,0 +1,42 @@
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#include <stdio.h>
+
+#include "list.h"
+#include "graph.h"
+#include "source.h"
+
+/*
+ * Pipelined map loader for input that can only be read once, such as a
+ * pipe, or that must be decompressed. Three stages run concurrently
+ * and are connected by bounded single-producer/single-consumer rings:
+ *
+ *   reader:  read large blocks from the source, decompressing them
+ *            if the map is gzip or zstd compressed,
+ *   parser:  split the blocks into lines, find the city names and
+ *            intern them,
+ *   builder: insert the new nodes and the edges into the graph,
+ *            which grows as the cities turn up.
+ *
+ * This way the read system calls and the decompression overlap with
+ * the parsing instead of alternating with it. Lines are handled exactly like in the
+ * sequential reader, so the resulting graph is the same.
+ */
+
+/**
+ * load_map_pipelined() - Build a graph from a stream of map lines.
+ * @src: Source of the map bytes. Not closed.
+ * @cities: Empty list that receives the city names in node order.
+ * @numCities: Set to the number of cities, i.e. nodes.
+ * @numEdges: Set to the number of edges inserted.
+ *
+ * The names in cities are owned by the caller and must be
+ * alloc_free()-d after the graph is killed.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted or could not be read.
+ */
+graph *load_map_pipelined(source *src, list *cities, int *numCities, int *numEdges);
+
+#endif
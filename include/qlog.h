@@ -0,0 +1,84 @@
+#ifndef __QLOG_H
+#define __QLOG_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "histogram.h"
+
+/*
+ * Query log capture and replay. A query log is a text file with a
+ * header line followed by one line per query:
+ *
+ *   <microseconds since start> <origin> <destination> <result>
+ *
+ * where result is 1 if there was a path, 0 if there was not and -1 if
+ * the query named an unknown city. Replaying a log runs every query
+ * again, either back to back or with the original pacing, and checks
+ * that each answer matches the recorded one.
+ */
+
+// Longest city name the log can hold, matching the interactive input.
+#define QLOG_NAME_MAX 39
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct qlog qlog;
+
+// Answers one query: 1 if there is a path, 0 if not, -1 if invalid.
+typedef int (*query_function)(void *ctx, const char *origin, const char *dest);
+
+typedef struct replay_result {
+    uint64_t queries;     // Queries replayed.
+    uint64_t mismatches;  // Answers that differed from the log.
+    double elapsed;       // Seconds from first to last query.
+} replay_result;
+
+// =================== QUERY LOG INTERFACE ======================
+
+/**
+ * qlog_create() - Start a new query log.
+ * @file: Name of the log file to create.
+ *
+ * Returns: A pointer to the new log, or NULL if the file could not be
+ * created.
+ */
+qlog *qlog_create(const char *file);
+
+/**
+ * qlog_record() - Append one query to the log.
+ * @log: Log to append to.
+ * @origin: Origin city.
+ * @dest: Destination city.
+ * @result: 1, 0 or -1 as described above.
+ *
+ * Returns: Nothing.
+ */
+void qlog_record(qlog *log, const char *origin, const char *dest, int result);
+
+/**
+ * qlog_kill() - Flush and close a query log.
+ * @log: Log to close.
+ *
+ * Returns: Nothing.
+ */
+void qlog_kill(qlog *log);
+
+/**
+ * qlog_replay() - Re-run every query of a captured log.
+ * @in: Log to read.
+ * @paced: If true, wait so that queries start at their recorded times.
+ * @answer: Function answering a query.
+ * @ctx: Passed on to answer.
+ * @latency: Histogram receiving the time of each query in ns.
+ * @res: Filled in with the outcome of the replay.
+ *
+ * Mismatching answers are reported on stderr.
+ *
+ * Returns: True if the log was well formed, otherwise false.
+ */
+bool qlog_replay(FILE *in, bool paced, query_function answer, void *ctx,
+                 histogram *latency, replay_result *res);
+
+#endif
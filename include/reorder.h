@@ -0,0 +1,79 @@
+#ifndef __REORDER_H
+#define __REORDER_H
+
+#include <stdbool.h>
+
+#include "graph.h"
+
+/*
+ * Renumbering of the nodes of a loaded graph, so that nodes joined by
+ * an edge get indices close together and a search touches fewer cache
+ * lines. The loaders number the cities in the order the map names them,
+ * which has nothing to do with how they are connected.
+ *
+ * The orders treat the edges as undirected:
+ *
+ *   bfs     breadth first, starting from the lowest index left,
+ *   rcm     reverse Cuthill-McKee: breadth first from a node of lowest
+ *           degree, taking the neighbours in order of degree, and the
+ *           whole order reversed,
+ *   degree  highest degree first, so the busiest nodes share lines.
+ *
+ * The first two keep each weakly connected part of the graph together.
+ *
+ * Names are not touched, so cities are found by name as before.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef enum graph_order {
+    ORDER_NONE,    // Keep the order of the map.
+    ORDER_BFS,
+    ORDER_RCM,
+    ORDER_DEGREE
+} graph_order;
+
+// Distance between the indices of the ends of the edges.
+typedef struct bandwidth {
+    int max;
+    double mean;
+} bandwidth;
+
+// =================== REORDER INTERFACE ======================
+
+/**
+ * reorder_parse() - Parse the name of an order.
+ * @s: "bfs", "rcm" or "degree".
+ * @order: Set to the order named by s.
+ *
+ * Returns: True if s names an order, otherwise false.
+ */
+bool reorder_parse(const char *s, graph_order *order);
+
+/**
+ * reorder_name() - Return the name of an order.
+ * @order: Order to name.
+ *
+ * Returns: The name reorder_parse() takes, or "none".
+ */
+const char *reorder_name(graph_order order);
+
+/**
+ * reorder_bandwidth() - Measure how far apart the ends of edges lie.
+ * @g: Graph to inspect.
+ *
+ * Returns: The largest and the mean index distance over all edges, both
+ * 0 if there are no edges.
+ */
+bandwidth reorder_bandwidth(const graph *g);
+
+/**
+ * reorder_graph() - Renumber the nodes of a graph.
+ * @g: Graph to renumber. Must not be compact yet.
+ * @order: Order to number the nodes in.
+ *
+ * Returns: The modified graph.
+ */
+graph *reorder_graph(graph *g, graph_order order);
+
+#endif
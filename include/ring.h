@@ -0,0 +1,72 @@
+#ifndef __RING_H
+#define __RING_H
+
+#include <stdbool.h>
+
+/*
+ * Bounded lock-free ring buffer for exactly one producer thread and one
+ * consumer thread. The ring stores void pointers. The two indices live
+ * on separate cache lines and are published with release stores and
+ * read with acquire loads, so no locks are needed while values flow.
+ * A side that has to wait spins briefly and then sleeps until the other
+ * side makes room or adds a value.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct ring ring;
+
+// =================== RING INTERFACE ======================
+
+/**
+ * ring_empty() - Create an empty ring.
+ * @capacity: Number of slots, rounded up to a power of two.
+ *
+ * Returns: A pointer to the new ring.
+ */
+ring *ring_empty(int capacity);
+
+/**
+ * ring_try_push() - Put a value in the ring if there is room.
+ * @r: Ring to modify. Only called by the producer.
+ * @v: Value to put.
+ *
+ * Returns: True if the value was put, false if the ring was full.
+ */
+bool ring_try_push(ring *r, void *v);
+
+/**
+ * ring_try_pop() - Take the oldest value from the ring if there is one.
+ * @r: Ring to modify. Only called by the consumer.
+ * @v: Set to the value taken.
+ *
+ * Returns: True if a value was taken, false if the ring was empty.
+ */
+bool ring_try_pop(ring *r, void **v);
+
+/**
+ * ring_push() - Put a value in the ring, waiting while it is full.
+ * @r: Ring to modify. Only called by the producer.
+ * @v: Value to put.
+ *
+ * Returns: Nothing.
+ */
+void ring_push(ring *r, void *v);
+
+/**
+ * ring_pop() - Take the oldest value, waiting while the ring is empty.
+ * @r: Ring to modify. Only called by the consumer.
+ *
+ * Returns: The value taken.
+ */
+void *ring_pop(ring *r);
+
+/**
+ * ring_kill() - Destroy a ring.
+ * @r: Ring to destroy. Values still in the ring are not freed.
+ *
+ * Returns: Nothing.
+ */
+void ring_kill(ring *r);
+
+#endif
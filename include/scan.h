@@ -0,0 +1,88 @@
+#ifndef __SCAN_H
+#define __SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Byte classifier for the map parser. One pass over a block of text
+ * produces three bitmaps with one bit per byte: newlines, white-space
+ * (the characters isspace() accepts in the C locale) and '#'. The
+ * parser then finds token boundaries with bit scans instead of looking
+ * at the bytes again.
+ *
+ * The classification uses AVX2 when the processor has it, SSE2 on
+ * other x86-64 processors and a scalar loop everywhere else.
+ */
+
+// Number of 64-bit mask words needed for len bytes.
+#define SCAN_WORDS(len) (((len) + 63) / 64)
+
+/**
+ * scan_classify() - Classify every byte of a block.
+ * @s: Block to classify.
+ * @len: Length of the block.
+ * @nl: SCAN_WORDS(len) words receiving the newline bits.
+ * @ws: SCAN_WORDS(len) words receiving the white-space bits.
+ * @hash: SCAN_WORDS(len) words receiving the '#' bits.
+ *
+ * Bit i%64 of word i/64 describes byte i. Bits past len are cleared.
+ *
+ * Returns: Nothing.
+ */
+void scan_classify(const char *s, size_t len, uint64_t *nl, uint64_t *ws,
+                   uint64_t *hash);
+
+/**
+ * scan_next() - Find the next set bit of a mask.
+ * @m: Mask to search.
+ * @from: First bit to look at.
+ * @limit: Bit to stop before. Must be covered by the mask.
+ *
+ * Returns: The position of the first set bit in [from, limit), or limit
+ * if there is none.
+ */
+static inline size_t scan_next(const uint64_t *m, size_t from, size_t limit)
+{
+    if (from >= limit) {
+        return limit;
+    }
+    size_t i = from >> 6;
+    uint64_t w = m[i] & (~(uint64_t)0 << (from & 63));
+    while (w == 0) {
+        if (((++i) << 6) >= limit) {
+            return limit;
+        }
+        w = m[i];
+    }
+    size_t r = (i << 6) + __builtin_ctzll(w);
+    return r < limit ? r : limit;
+}
+
+/**
+ * scan_next_clear() - Find the next cleared bit of a mask.
+ * @m: Mask to search.
+ * @from: First bit to look at.
+ * @limit: Bit to stop before. Must be covered by the mask.
+ *
+ * Returns: The position of the first cleared bit in [from, limit), or
+ * limit if there is none.
+ */
+static inline size_t scan_next_clear(const uint64_t *m, size_t from, size_t limit)
+{
+    if (from >= limit) {
+        return limit;
+    }
+    size_t i = from >> 6;
+    uint64_t w = ~m[i] & (~(uint64_t)0 << (from & 63));
+    while (w == 0) {
+        if (((++i) << 6) >= limit) {
+            return limit;
+        }
+        w = ~m[i];
+    }
+    size_t r = (i << 6) + __builtin_ctzll(w);
+    return r < limit ? r : limit;
+}
+
+#endif
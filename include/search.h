@@ -0,0 +1,95 @@
+#ifndef __SEARCH_H
+#define __SEARCH_H
+
+#include <stdbool.h>
+
+#include "graph.h"
+#include "shmgraph.h"
+#include "stats.h"
+
+/*
+ * Breadth-first reachability search that keeps its visited marks and
+ * queue in a searcher instead of in the nodes. Several threads can
+ * therefore search the same graph at once, each with its own searcher,
+ * as long as nobody modifies the graph meanwhile.
+ *
+ * The visited marks are one bit per node. After a short search only the
+ * bits of the queued nodes are cleared, otherwise whole words.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct searcher searcher;
+
+// =================== SEARCH INTERFACE ======================
+
+/**
+ * searcher_empty() - Create a searcher.
+ *
+ * The searcher grows to the size of the graphs it is used on.
+ *
+ * Returns: A pointer to the new searcher.
+ */
+searcher *searcher_empty(void);
+
+/**
+ * searcher_find_path() - Check for a path between two nodes.
+ * @s: Searcher owned by the calling thread.
+ * @g: Graph to inspect. Not modified.
+ * @n1: Origin node.
+ * @n2: Destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The search stops as soon as the destination is reached, and is not
+ * started if the nodes are in different components of a labelled
+ * graph. If stats is given it is overwritten with the cost of this
+ * search.
+ *
+ * Returns: True if a path exists from n1 to n2.
+ */
+bool searcher_find_path(searcher *s, const graph *g, const node *n1,
+                        const node *n2, search_stats *stats);
+
+/**
+ * searcher_reaching() - Find every node with a path to a node.
+ * @s: Searcher owned by the calling thread.
+ * @g: Graph to inspect, keeping in-edges. Not modified.
+ * @n: Destination node.
+ * @nodes: Set to the indices of the nodes found, in order of distance.
+ *         Valid until the searcher is used again.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The search follows the in-edges backwards from n, so its cost grows
+ * with the size of the answer and not with the size of the graph. The
+ * node n itself is left out.
+ *
+ * Returns: The number of nodes found.
+ */
+int searcher_reaching(searcher *s, const graph *g, const node *n,
+                      const int **nodes, search_stats *stats);
+
+/**
+ * searcher_find_path_shm() - Check for a path in a shared graph.
+ * @s: Searcher owned by the calling thread.
+ * @sg: Attached graph to inspect.
+ * @from: Index of the origin node.
+ * @to: Index of the destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * Works like searcher_find_path(), but reads the neighbours straight
+ * from the segment, so nothing is allocated per visited node.
+ *
+ * Returns: True if a path exists from the origin to the destination.
+ */
+bool searcher_find_path_shm(searcher *s, const shmgraph *sg, int from, int to,
+                            search_stats *stats);
+
+/**
+ * searcher_kill() - Destroy a searcher.
+ * @s: Searcher to destroy.
+ *
+ * Returns: Nothing.
+ */
+void searcher_kill(searcher *s);
+
+#endif
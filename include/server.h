@@ -0,0 +1,64 @@
+#ifndef __SERVER_H
+#define __SERVER_H
+
+#include <stdbool.h>
+
+#include "list.h"
+#include "graph.h"
+#include "reorder.h"
+
+/*
+ * Query server. The graph is loaded once and then queried by any number
+ * of clients over a Unix domain socket.
+ *
+ * The protocol is line based. A client sends
+ *
+ *   <origin> <destination>\n
+ *
+ * and gets one answer line per request, in request order:
+ *
+ *   1\n    there is a path,
+ *   0\n    there is no path,
+ *   -1\n   either city is not in the map,
+ *   ERR <reason>\n for a malformed request.
+ *
+ * The line "reload" (or SIGHUP) makes the server build a new graph
+ * from the map file in the background and answers "OK reloading". See
+ * below for how the graphs are swapped.
+ *
+ * A client may send several requests before reading the answers. One
+ * thread runs an epoll event loop over all connections and hands the
+ * searches to a pool of worker threads, each with its own searcher.
+ * SIGINT or SIGTERM stops the server.
+ *
+ * The graph is replaced RCU style. Workers only read the current graph
+ * snapshot through an atomic pointer and announce when they are between
+ * requests (quiescent state based reclamation). A reload builds the new
+ * snapshot on its own thread, swaps the pointer and frees the old
+ * snapshot once every worker has been quiescent since the swap. Queries
+ * never wait for a reload, they are answered by whichever snapshot was
+ * current when they started.
+ */
+
+// Longest request line accepted, including the newline.
+#define SERVER_LINE_MAX 4096
+
+/**
+ * server_run() - Answer queries on a Unix domain socket until stopped.
+ * @path: Path of the socket. A stale socket file is replaced.
+ * @map: Map file that g was loaded from, read again on a reload.
+ * @g: Graph to query first. If it is compact, reloaded graphs are too.
+ * @cities: List of the city names of g.
+ * @order: Order that g was renumbered in, reloaded graphs are too.
+ * @workers: Number of search threads, 0 means one per core.
+ * @showStats: If true, print the totals and latency on exit.
+ *
+ * The server takes over g, cities and the names in it, and frees them
+ * when they have been replaced or the server stops.
+ *
+ * Returns: 0 after a normal stop, -1 if the server could not start.
+ */
+int server_run(const char *path, const char *map, graph *g, list *cities,
+               graph_order order, int workers, bool showStats);
+
+#endif
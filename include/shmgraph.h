@@ -0,0 +1,122 @@
+#ifndef __SHMGRAPH_H
+#define __SHMGRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "graph.h"
+
+/*
+ * A graph frozen into a POSIX shared memory segment so that any number
+ * of query processes on the host can use one copy of it.
+ *
+ * The segment is written once by shmgraph_build() and never changed.
+ * It holds no pointers, only offsets from its own start, so it can be
+ * mapped at any address. Its layout is
+ *
+ *   header   sizes and the offsets of the sections below,
+ *   first    numNodes + 1 edge offsets, the neighbours of node i are
+ *            targets[first[i]] .. targets[first[i + 1] - 1],
+ *   targets  numEdges node indices,
+ *   nameAt   numNodes + 1 offsets into the name bytes,
+ *   names    the '\0'-terminated city names, in node order,
+ *   slots    open addressing hash table, node index + 1 or 0 if free.
+ *
+ * shmgraph_attach() maps the segment read-only. Nothing is copied, so
+ * an attached process can answer queries at once and the pages are
+ * shared with every other process that has the segment attached.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct shmgraph shmgraph;
+
+// =================== SHARED GRAPH INTERFACE ======================
+
+/**
+ * shmgraph_build() - Write a graph into a new shared memory segment.
+ * @name: Name of the segment, such as "/airmap". A missing leading '/'
+ *        is added.
+ * @g: Graph to write. Not modified.
+ * @bytes: Set to the size of the segment, or NULL if not wanted.
+ *
+ * A segment of the same name is replaced. Processes that have the old
+ * segment attached keep using it until they detach.
+ *
+ * Returns: 0 on success, or -1 after printing an error message.
+ */
+int shmgraph_build(const char *name, const graph *g, size_t *bytes);
+
+/**
+ * shmgraph_attach() - Map a shared graph read-only.
+ * @name: Name of the segment given to shmgraph_build().
+ *
+ * Returns: A pointer to the attached graph, or NULL after printing an
+ * error message if the segment is missing or not a complete graph.
+ */
+shmgraph *shmgraph_attach(const char *name);
+
+/**
+ * shmgraph_node_count() - Return the number of nodes.
+ * @sg: Attached graph.
+ *
+ * Returns: The number of nodes.
+ */
+int shmgraph_node_count(const shmgraph *sg);
+
+/**
+ * shmgraph_edge_count() - Return the number of edges.
+ * @sg: Attached graph.
+ *
+ * Returns: The number of edges.
+ */
+int shmgraph_edge_count(const shmgraph *sg);
+
+/**
+ * shmgraph_size() - Return the size of the segment.
+ * @sg: Attached graph.
+ *
+ * Returns: The size of the segment in bytes.
+ */
+size_t shmgraph_size(const shmgraph *sg);
+
+/**
+ * shmgraph_lookup() - Find a node by its name.
+ * @sg: Attached graph.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the node, or -1 if there is no such city.
+ */
+int shmgraph_lookup(const shmgraph *sg, const char *name);
+
+/**
+ * shmgraph_neighbours() - Return the neighbours of a node.
+ * @sg: Attached graph.
+ * @i: Index of the node.
+ * @count: Set to the number of neighbours.
+ *
+ * Returns: The node indices of the neighbours, in the segment.
+ */
+const uint32_t *shmgraph_neighbours(const shmgraph *sg, int i, int *count);
+
+/**
+ * shmgraph_detach() - Unmap a shared graph. The segment is kept.
+ * @sg: Attached graph.
+ *
+ * Returns: Nothing.
+ */
+void shmgraph_detach(shmgraph *sg);
+
+/**
+ * shmgraph_unlink() - Remove a shared memory segment.
+ * @name: Name of the segment.
+ *
+ * Attached processes keep their mapping. The memory is returned when
+ * the last of them detaches.
+ *
+ * Returns: 0 on success, or -1 after printing an error message.
+ */
+int shmgraph_unlink(const char *name);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef __SOURCE_H
+#define __SOURCE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Byte source for the map loaders. A source reads a map file, and
+ * decompresses it on the fly if it is gzip (zlib) or zstd compressed.
+ * The format is recognized from the first bytes of the file, so a
+ * compressed map can also be piped in. Decompressed data is only ever
+ * held one block at a time.
+ *
+ * Support for the compressed formats is compiled in with -DHAVE_ZLIB
+ * (link with -lz) and -DHAVE_ZSTD (link with -lzstd).
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct source source;
+
+// =================== SOURCE INTERFACE ======================
+
+/**
+ * source_open() - Create a source reading from a map file.
+ * @in: Map file opened for reading. Nothing may have been read from it.
+ *
+ * For a regular file the first bytes are inspected without moving the
+ * file position, so the file can still be read directly if the source
+ * turns out not to be compressed.
+ *
+ * Returns: A pointer to the new source, or NULL if the file is in a
+ * compressed format this build can not read.
+ */
+source *source_open(FILE *in);
+
+/**
+ * source_is_compressed() - Check if a source decompresses its file.
+ * @s: Source to inspect.
+ *
+ * Returns: True if the file is compressed, otherwise false.
+ */
+bool source_is_compressed(const source *s);
+
+/**
+ * source_peek() - Look at the first bytes of the (decompressed) map.
+ * @s: Source to look at. Nothing may have been read from it.
+ * @buf: Buffer receiving the bytes.
+ * @len: Size of buf.
+ *
+ * A plain regular file is read with pread(), other files are decoded
+ * and the bytes kept, so source_read() still starts at the beginning
+ * of the map. Only the bytes of the first peek are kept. A stream is
+ * only read until its first line is complete, so a slow pipe is not
+ * waited on for more than that.
+ *
+ * Returns: The number of bytes copied to buf, at least the whole first
+ * line unless it is longer than len, or -1 on an error, in which case a
+ * message has been printed.
+ */
+ssize_t source_peek(source *s, char *buf, size_t len);
+
+/**
+ * source_read() - Read the next bytes of the (decompressed) map.
+ * @s: Source to read from.
+ * @buf: Buffer receiving the bytes.
+ * @len: Size of buf.
+ *
+ * Returns: The number of bytes read, 0 at the end of the map or -1 on
+ * an error, in which case a message has been printed.
+ */
+ssize_t source_read(source *s, char *buf, size_t len);
+
+/**
+ * source_close() - Destroy a source. The map file is not closed.
+ * @s: Source to destroy.
+ *
+ * Returns: Nothing.
+ */
+void source_close(source *s);
+
+#endif
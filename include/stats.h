@@ -0,0 +1,61 @@
+#ifndef __STATS_H
+#define __STATS_H
+
+#include <stdio.h>
+
+/*
+ * Lightweight counters describing what a reachability query costs.
+ * find_path() fills in one search_stats per query, which can then be
+ * added to a cumulative total for the whole session.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct search_stats {
+    unsigned long queries;        // Number of queries counted.
+    unsigned long nodes_visited;  // Nodes dequeued by the search.
+    unsigned long edges_relaxed;  // Neighbour entries scanned.
+    unsigned long frontier_peak;  // Largest queue length seen.
+    unsigned long allocations;    // Search queues allocated.
+    double wall_time;             // Seconds spent searching.
+} search_stats;
+
+// =================== STATS INTERFACE ======================
+
+/**
+ * stats_now() - Read a monotonic clock.
+ *
+ * Returns: The current time in seconds.
+ */
+double stats_now(void);
+
+/**
+ * stats_reset() - Clear all counters.
+ * @s: Stats to clear.
+ *
+ * Returns: Nothing.
+ */
+void stats_reset(search_stats *s);
+
+/**
+ * stats_add() - Add the counters of one set of stats to another.
+ * @total: Stats to accumulate into.
+ * @s: Stats to add.
+ *
+ * The frontier peak of the total is the largest peak seen.
+ *
+ * Returns: Nothing.
+ */
+void stats_add(search_stats *total, const search_stats *s);
+
+/**
+ * stats_print() - Print a set of stats on one line.
+ * @out: Stream to print to.
+ * @label: Text printed in front of the counters.
+ * @s: Stats to print.
+ *
+ * Returns: Nothing.
+ */
+void stats_print(FILE *out, const char *label, const search_stats *s);
+
+#endif
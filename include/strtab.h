@@ -0,0 +1,78 @@
+#ifndef __STRTAB_H
+#define __STRTAB_H
+
+#include <stdbool.h>
+
+/*
+ * String interning table. Each distinct string gets a dense integer id,
+ * 0, 1, 2, ..., in the order the strings were first interned. Lookups
+ * use open addressing on a hash of the string, so interning and
+ * looking up are expected O(length of the string).
+ *
+ * Interned strings are copied into memory owned by the table. When the
+ * table is killed the copies can either be freed or be left to the
+ * user, who then must alloc_free() them.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct strtab strtab;
+
+// =================== STRING TABLE INTERFACE ======================
+
+/**
+ * strtab_empty() - Create an empty string table.
+ * @capacity: Expected number of strings, or 0 if not known.
+ *
+ * Returns: A pointer to the new table.
+ */
+strtab *strtab_empty(int capacity);
+
+/**
+ * strtab_lookup() - Find the id of a string.
+ * @t: Table to search.
+ * @s: String to look for, need not be '\0'-terminated.
+ * @len: Length of s.
+ *
+ * Returns: The id of the string, or -1 if it has not been interned.
+ */
+int strtab_lookup(const strtab *t, const char *s, int len);
+
+/**
+ * strtab_intern() - Find or add a string.
+ * @t: Table to modify.
+ * @s: String to intern, need not be '\0'-terminated.
+ * @len: Length of s.
+ * @added: Set to true if the string was new, otherwise false. May be NULL.
+ *
+ * Returns: The id of the string.
+ */
+int strtab_intern(strtab *t, const char *s, int len, bool *added);
+
+/**
+ * strtab_name() - Return the interned copy of a string.
+ * @t: Table to inspect.
+ * @id: Id of the string.
+ *
+ * Returns: The '\0'-terminated copy owned by the table.
+ */
+const char *strtab_name(const strtab *t, int id);
+
+/**
+ * strtab_size() - Return the number of interned strings.
+ * @t: Table to inspect.
+ *
+ * Returns: The number of strings, which is also the next id.
+ */
+int strtab_size(const strtab *t);
+
+/**
+ * strtab_kill() - Destroy a string table.
+ * @t: Table to destroy.
+ * @free_names: If false, the interned copies are left to the user.
+ *
+ * Returns: Nothing.
+ */
+void strtab_kill(strtab *t, bool free_names);
+
+#endif
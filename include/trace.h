@@ -0,0 +1,58 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+/*
+ * Timeline tracing in the Chrome trace-event format. The resulting JSON
+ * file can be opened in Perfetto or chrome://tracing.
+ *
+ * Tracing is compiled in only when TRACE is defined (-DTRACE). In a
+ * normal build every macro below expands to nothing, so spans may be
+ * left in hot code. Spans are opened with TRACE_BEGIN() and closed with
+ * TRACE_END() in the same function and nest like scopes.
+ */
+
+#ifdef TRACE
+
+#include <stdbool.h>
+
+/**
+ * trace_open() - Start writing trace events to a file.
+ * @file: Name of the JSON file to create.
+ *
+ * Returns: True if the file could be created, otherwise false.
+ */
+bool trace_open(const char *file);
+
+/**
+ * trace_event() - Write one begin or end event.
+ * @name: Name of the span.
+ * @phase: 'B' to begin the span, 'E' to end it.
+ *
+ * Does nothing unless trace_open() has succeeded.
+ *
+ * Returns: Nothing.
+ */
+void trace_event(const char *name, char phase);
+
+/**
+ * trace_close() - Finish the trace file.
+ *
+ * Returns: Nothing.
+ */
+void trace_close(void);
+
+#define TRACE_OPEN(file) trace_open(file)
+#define TRACE_BEGIN(name) trace_event((name), 'B')
+#define TRACE_END(name) trace_event((name), 'E')
+#define TRACE_CLOSE() trace_close()
+
+#else
+
+#define TRACE_OPEN(file) false
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_CLOSE()
+
+#endif
+
+#endif
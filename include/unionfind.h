@@ -0,0 +1,127 @@
+#ifndef __UNIONFIND_H
+#define __UNIONFIND_H
+
+#include <stdbool.h>
+
+#include "source.h"
+#include "stats.h"
+
+/*
+ * Connectivity of an undirected map, kept as a union-find forest over
+ * the cities instead of as a graph.
+ *
+ * Each edge joins the sets of its two cities as the map is read, and
+ * is then forgotten, so no neighbour lists are stored at all. Two
+ * cities are connected if they are in the same set. Sets are joined by
+ * rank and paths are compressed when a root is looked up, which makes
+ * every query two lookups in close to constant time.
+ *
+ * Since every edge is taken to run both ways, the answers are only
+ * those of find_path() when the map really is undirected. A forest can
+ * also be built by index, without names, to find the weakly connected
+ * parts of a directed graph.
+ */
+
+// ====================== PUBLIC DATA TYPES ==========================
+
+typedef struct unionfind unionfind;
+
+// =================== UNION-FIND INTERFACE ======================
+
+/**
+ * unionfind_load() - Read a map into a union-find forest.
+ * @src: Source of the map bytes. Not closed.
+ *
+ * Lines are handled by the same rules as when the map is loaded into
+ * a graph.
+ *
+ * Returns: A pointer to the new forest, or NULL after printing an error
+ * message if the map is badly formatted.
+ */
+unionfind *unionfind_load(source *src);
+
+/**
+ * unionfind_empty() - Create a forest of single element sets.
+ * @n: Number of elements, with the indices 0 to n-1.
+ *
+ * The forest has no names, so unionfind_lookup() must not be used.
+ *
+ * Returns: A pointer to the new forest.
+ */
+unionfind *unionfind_empty(int n);
+
+/**
+ * unionfind_union() - Join the sets of two elements.
+ * @uf: Forest to modify.
+ * @a: Index of the first element.
+ * @b: Index of the second element.
+ *
+ * Returns: True if the elements were in different sets before.
+ */
+bool unionfind_union(unionfind *uf, int a, int b);
+
+/**
+ * unionfind_find() - Return the representative of the set of an element.
+ * @uf: Forest to inspect. Paths in it are compressed.
+ * @i: Index of the element.
+ *
+ * Returns: The index of the element representing the set.
+ */
+int unionfind_find(unionfind *uf, int i);
+
+/**
+ * unionfind_node_count() - Return the number of cities.
+ * @uf: Forest to inspect.
+ *
+ * Returns: The number of cities.
+ */
+int unionfind_node_count(const unionfind *uf);
+
+/**
+ * unionfind_edge_count() - Return the number of edges read from the map.
+ * @uf: Forest to inspect.
+ *
+ * Returns: The number of edges.
+ */
+int unionfind_edge_count(const unionfind *uf);
+
+/**
+ * unionfind_set_count() - Return the number of connected parts.
+ * @uf: Forest to inspect.
+ *
+ * Returns: The number of sets.
+ */
+int unionfind_set_count(const unionfind *uf);
+
+/**
+ * unionfind_lookup() - Find a city by its name.
+ * @uf: Forest to inspect.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the city, or -1 if there is no such city.
+ */
+int unionfind_lookup(const unionfind *uf, const char *name);
+
+/**
+ * unionfind_connected() - Check if two cities are connected.
+ * @uf: Forest to inspect. Paths in it are compressed.
+ * @from: Index of the origin city.
+ * @to: Index of the destination city.
+ * @stats: Counters for this query, or NULL if not wanted.
+ *
+ * The nodes visited count the steps taken towards the two roots. If
+ * stats is given it is overwritten with the cost of this query.
+ *
+ * Returns: True if the cities are in the same set.
+ */
+bool unionfind_connected(unionfind *uf, int from, int to, search_stats *stats);
+
+/**
+ * unionfind_kill() - Destroy a forest.
+ * @uf: Forest to destroy.
+ *
+ * Returns: Nothing.
+ */
+void unionfind_kill(unionfind *uf);
+
+#endif
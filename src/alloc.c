@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "alloc.h"
+
+/*
+ * Implementation of the tracking allocation layer. The tracking
+ * functions are only compiled in when ALLOC_TRACK is defined, see
+ * alloc.h; check() is always there.
+ *
+ * Each block is prefixed by a header holding its size and tag, so that
+ * alloc_free() can charge the right counters. Counters are updated with
+ * atomic builtins so that threaded code may allocate concurrently.
+ */
+
+#ifdef ALLOC_TRACK
+
+// Header placed in front of every block, padded to keep the user
+// memory aligned for any type.
+typedef union header {
+    struct {
+        size_t size;
+        alloc_tag tag;
+    } info;
+    max_align_t align;
+} header;
+
+struct counters {
+    size_t live;
+    size_t peak;
+    size_t count;
+};
+
+static struct counters tags[ALLOC_TAG_COUNT];
+static struct counters all;
+
+static const char *tag_names[ALLOC_TAG_COUNT] = {
+    "array", "list", "dlist", "queue", "graph", "loader", "stats", "server"
+};
+
+/* Add delta bytes to a set of counters and raise its peak if needed. */
+static void charge(struct counters *c, size_t size, int sign)
+{
+    size_t live;
+    if (sign > 0) {
+        live = __atomic_add_fetch(&c->live, size, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&c->count, 1, __ATOMIC_RELAXED);
+    } else {
+        live = __atomic_sub_fetch(&c->live, size, __ATOMIC_RELAXED);
+    }
+    size_t peak = __atomic_load_n(&c->peak, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&c->peak, &peak, live, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // peak was reloaded by the failed exchange, try again.
+    }
+}
+
+/* Fill in the header of a fresh block and return the user pointer. */
+static void *track(header *h, alloc_tag tag, size_t size)
+{
+    if (h == NULL) {
+        return NULL;
+    }
+    h->info.size = size;
+    h->info.tag = tag;
+    charge(&tags[tag], size, 1);
+    charge(&all, size, 1);
+    return h + 1;
+}
+
+/**
+ * alloc_calloc() - Allocate zeroed memory for n elements.
+ * @tag: Subsystem making the allocation.
+ * @n: Number of elements.
+ * @size: Size of each element.
+ *
+ * Returns: A pointer to the memory, or NULL if none was available.
+ */
+void *alloc_calloc(alloc_tag tag, size_t n, size_t size){
+    if (size != 0 && n > ((size_t)-1 - sizeof(header)) / size)
+    {
+        return NULL;
+    }
+    return track(calloc(1, sizeof(header) + n * size), tag, n * size);
+}
+
+/**
+ * alloc_malloc() - Allocate uninitialized memory.
+ * @tag: Subsystem making the allocation.
+ * @size: Number of bytes.
+ *
+ * Returns: A pointer to the memory, or NULL if none was available.
+ */
+void *alloc_malloc(alloc_tag tag, size_t size){
+    return track(malloc(sizeof(header) + size), tag, size);
+}
+
+/**
+ * alloc_realloc() - Change the size of an allocation.
+ * @tag: Subsystem making the allocation.
+ * @p: Memory from this layer, or NULL.
+ * @size: New number of bytes.
+ *
+ * Returns: A pointer to the memory, or NULL if none was available in
+ * which case p is left untouched.
+ */
+void *alloc_realloc(alloc_tag tag, void *p, size_t size){
+    if (p == NULL)
+    {
+        return alloc_malloc(tag, size);
+    }
+    header *old = (header *)p - 1;
+    size_t oldSize = old->info.size;
+    alloc_tag oldTag = old->info.tag;
+    header *h = realloc(old, sizeof(header) + size);
+    if (h == NULL)
+    {
+        return NULL;
+    }
+    charge(&tags[oldTag], oldSize, -1);
+    charge(&all, oldSize, -1);
+    return track(h, tag, size);
+}
+
+/**
+ * alloc_free() - Return memory allocated by this layer.
+ * @p: Memory to free, or NULL.
+ *
+ * Returns: Nothing.
+ */
+void alloc_free(void *p){
+    if (p == NULL)
+    {
+        return;
+    }
+    header *h = (header *)p - 1;
+    charge(&tags[h->info.tag], h->info.size, -1);
+    charge(&all, h->info.size, -1);
+    free(h);
+}
+
+/**
+ * alloc_report() - Print live bytes, peak bytes and count per tag.
+ * @out: Stream to print to.
+ * @checkpoint: Name of the point in the program being reported.
+ *
+ * Returns: Nothing.
+ */
+void alloc_report(FILE *out, const char *checkpoint){
+    fprintf(out, "alloc[%s]:", checkpoint);
+    for (int i = 0; i < ALLOC_TAG_COUNT; i++)
+    {
+        if (tags[i].count == 0)
+        {
+            continue;
+        }
+        fprintf(out, " %s=%zu/%zu/%zu", tag_names[i],
+                __atomic_load_n(&tags[i].live, __ATOMIC_RELAXED),
+                __atomic_load_n(&tags[i].peak, __ATOMIC_RELAXED),
+                __atomic_load_n(&tags[i].count, __ATOMIC_RELAXED));
+    }
+    fprintf(out, " total=%zu/%zu/%zu (live/peak bytes/allocations)\n",
+            __atomic_load_n(&all.live, __ATOMIC_RELAXED),
+            __atomic_load_n(&all.peak, __ATOMIC_RELAXED),
+            __atomic_load_n(&all.count, __ATOMIC_RELAXED));
+}
+
+#endif
+
+/**
+ * check() - Abort if an allocation failed.
+ * @p: Pointer returned by one of the allocation functions.
+ *
+ * Prints "Unable to allocate memory." and exits the program if p is
+ * NULL.
+ *
+ * Returns: p.
+ */
+void *check(void *p){
+    if (p == NULL)
+    {
+        printf("Unable to allocate memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    return p;
+}
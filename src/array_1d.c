@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "array_1d.h"
 
 /*
@@ -46,7 +47,7 @@ struct array_1d {
 array_1d *array_1d_create(int lo, int hi, free_function free_func)
 {
 	// Allocate array structure.
-	array_1d *a=calloc(1, sizeof(*a));
+	array_1d *a=alloc_calloc(ALLOC_ARRAY, 1, sizeof(*a));
 	// Store index limit.
 	a->low=lo;
 	a->high=hi;
@@ -57,11 +58,11 @@ array_1d *array_1d_create(int lo, int hi, free_function free_func)
 	// Store free function.
 	a->free_func=free_func;
 	
-	a->values=calloc(a->array_size, sizeof(void *));
+	a->values=alloc_calloc(ALLOC_ARRAY, a->array_size, sizeof(void *));
 	
 	// Check whether the allocation succeeded.
 	if (a->values == NULL) {
-		free(a);
+		alloc_free(a);
 		a=NULL;
 	}
 	return a;
@@ -160,9 +161,9 @@ void array_1d_kill(array_1d *a)
 		}
 	}
 	// Free actual storage.
-	free(a->values);
+	alloc_free(a->values);
 	// Free array structure.
-	free(a);
+	alloc_free(a);
 }
 
 /**
@@ -0,0 +1,56 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "bitset.h"
+
+/*
+ * Implementation of the dense bit set.
+ */
+
+/**
+ * bitset_empty() - Create an empty set.
+ *
+ * Returns: A pointer to the new set.
+ */
+bitset *bitset_empty(void){
+    return check(alloc_calloc(ALLOC_QUEUE, 1, sizeof(bitset)));
+}
+
+/**
+ * bitset_clear() - Remove all members and make room for more.
+ * @b: Set to clear.
+ * @bits: Number of bits that will be used, 0 to bits-1.
+ *
+ * Whole words are cleared at a time, only as many as the bits need.
+ *
+ * Returns: Nothing.
+ */
+void bitset_clear(bitset *b, size_t bits){
+    size_t need = (bits + 63) / 64;
+    if (need > b->numWords)
+    {
+        // Fresh memory is zeroed already
+        alloc_free(b->words);
+        b->words = check(alloc_calloc(ALLOC_QUEUE, need, sizeof(uint64_t)));
+        b->numWords = need;
+        return;
+    }
+    memset(b->words, 0, need * sizeof(uint64_t));
+}
+
+/**
+ * bitset_kill() - Destroy a set.
+ * @b: Set to destroy, or NULL.
+ *
+ * Returns: Nothing.
+ */
+void bitset_kill(bitset *b){
+    if (b == NULL)
+    {
+        return;
+    }
+    alloc_free(b->words);
+    alloc_free(b);
+}
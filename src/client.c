@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+
+/*
+ * Client for the query server. With two city names it asks one
+ * question and exits with status 0 if there is a path, 1 if there is
+ * none and 2 otherwise. With "reload" it asks the server to reload its
+ * map. Without names it asks for origin and destination like the
+ * interactive program does.
+ */
+
+/* Connect to the server socket, or return -1. */
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        fprintf(stderr, "Failed to connect to %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Ask one question. Returns 1, 0, -1 as the server, or -2 on failure. */
+static int ask(FILE *to, FILE *from, const char *origin, const char *dest)
+{
+    char answer[SERVER_LINE_MAX];
+    fprintf(to, "%s %s\n", origin, dest);
+    if (fflush(to) == EOF || fgets(answer, sizeof(answer), from) == NULL) {
+        fprintf(stderr, "Lost the connection to the server\n");
+        return -2;
+    }
+    if (!strncmp(answer, "ERR", 3)) {
+        fprintf(stderr, "Server: %s", answer + (answer[3] == ' ' ? 4 : 3));
+        return -1;
+    }
+    return atoi(answer);
+}
+
+/* Print an answer the way the interactive program does. */
+static void print_answer(int result, const char *origin, const char *dest)
+{
+    if (result > 0) {
+        printf("There is a path from %s to %s.\n\n", origin, dest);
+    } else if (result == 0) {
+        printf("There is no path from %s to %s.\n\n", origin, dest);
+    } else if (result == -1) {
+        fprintf(stderr, "Invalid input. Try again\n\n");
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    if (argc < 2 || argc > 4 || (argc == 3 && strcmp(argv[2], "reload"))) {
+        fprintf(stderr, "Usage: ./client socket [origin destination | reload]\n");
+        return 2;
+    }
+    int fd = connect_to(argv[1]);
+    if (fd < 0) {
+        return 2;
+    }
+    FILE *from = fdopen(fd, "r");
+    FILE *to = fdopen(dup(fd), "w");
+    if (from == NULL || to == NULL) {
+        fprintf(stderr, "Failed to open the connection: %s\n", strerror(errno));
+        return 2;
+    }
+
+    int status = 0;
+    if (argc == 3) {
+        char answer[SERVER_LINE_MAX];
+        fprintf(to, "reload\n");
+        if (fflush(to) == EOF || fgets(answer, sizeof(answer), from) == NULL) {
+            fprintf(stderr, "Lost the connection to the server\n");
+            status = 2;
+        } else {
+            printf("%s", answer);
+            status = strncmp(answer, "OK", 2) ? 2 : 0;
+        }
+    } else if (argc == 4) {
+        int result = ask(to, from, argv[2], argv[3]);
+        print_answer(result, argv[2], argv[3]);
+        status = result > 0 ? 0 : result == 0 ? 1 : 2;
+    } else {
+        char origin[40];
+        char dest[40];
+        while (1) {
+            printf("Enter origin and destination (quit to exit): ");
+            if (scanf("%39s", origin) != 1 || !strcmp(origin, "quit")) {
+                break;
+            }
+            if (scanf("%39s", dest) != 1) {
+                break;
+            }
+            int result = ask(to, from, origin, dest);
+            if (result == -2) {
+                status = 2;
+                break;
+            }
+            print_answer(result, origin, dest);
+        }
+        printf("Normal exit.\n");
+    }
+    fclose(to);
+    fclose(from);
+    return status;
+}
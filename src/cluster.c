@@ -0,0 +1,945 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "alloc.h"
+#include "strtab.h"
+#include "loader.h"
+#include "cluster.h"
+
+/*
+ * Implementation of the sharded reachability search.
+ */
+
+// Passes of single node moves after the parts have been grown.
+#define REFINE_PASSES 8
+
+// Bytes of the map read at a time.
+#define READ_SIZE (1 << 16)
+
+// Edges moved to and from a spill file at a time.
+#define SPILL_PAIRS 4096
+
+// Requests from the coordinator to a worker.
+#define OP_SHARD 1     // The shard of the worker follows.
+#define OP_STEP 2      // One round of a search, the seed nodes follow.
+
+// Header of a request. For OP_SHARD count is the number of nodes and to
+// the number of edges, for OP_STEP count is the number of seeds.
+typedef struct request {
+    int op;
+    unsigned query;    // Search the round belongs to.
+    int to;            // Local index of the destination, or -1.
+    int count;
+} request;
+
+// Header of the answer to a round, followed by count node indices.
+typedef struct reply {
+    int found;
+    int count;
+    unsigned long visited;
+    unsigned long edges;
+} reply;
+
+// The part of the graph owned by a worker. Targets owned by the worker
+// are local indices, others are stored as -(global index + 1).
+typedef struct shard {
+    int numNodes;
+    int numEdges;
+    int *first;
+    int *targets;
+    uint32_t *mark;
+    uint32_t stamp;
+    unsigned query;
+    int *queue;
+    int *out;
+    int outCap;
+} shard;
+
+// A worker as seen by the coordinator.
+typedef struct worker {
+    pid_t pid;
+    int requests;      // Pipe to the worker.
+    int replies;       // Pipe from the worker.
+    int *seeds;        // Local indices to search from in the next round.
+    int numSeeds;
+    int seedCap;
+    bool active;       // Asked in the current round.
+} worker;
+
+// Edges kept in a temporary file as pairs of node indices, so that the
+// coordinator does not hold them while it partitions or builds a shard.
+typedef struct spill {
+    FILE *file;
+    int *pairs;        // Buffered pairs, two ints each.
+    int len;           // Ints in pairs.
+    int pos;           // Next int of pairs to read.
+    bool failed;       // A write did not succeed.
+} spill;
+
+struct cluster {
+    int shards;
+    int started;
+    worker *workers;
+    strtab *names;
+    int numNodes;
+    int numEdges;      // Edges read from the map.
+    int *owner;        // Shard of each node.
+    int *local;        // Index of each node in its shard.
+    uint32_t *mark;    // mark[i] == stamp if node i is reached this search.
+    uint32_t stamp;
+    unsigned query;
+    int *found;        // Node indices of one reply.
+    int foundCap;
+};
+
+/* Write all bytes to a pipe. */
+static bool write_all(int fd, const void *p, size_t len)
+{
+    const char *s = p;
+    while (len > 0) {
+        ssize_t n = write(fd, s, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        s += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Read exactly len bytes from a pipe. False at the end or on error. */
+static bool read_all(int fd, void *p, size_t len)
+{
+    char *s = p;
+    while (len > 0) {
+        ssize_t n = read(fd, s, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        s += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* The coordinator can not go on without all of its workers. */
+static void lost_worker(void)
+{
+    fprintf(stderr, "ERROR: Lost a shard worker!\n");
+    exit(EXIT_FAILURE);
+}
+
+/* Make room for n ints in a growable array. */
+static int *reserve(int *a, int *cap, int n)
+{
+    if (n > *cap) {
+        *cap = n > 2 * *cap ? n : 2 * *cap;
+        a = check(alloc_realloc(ALLOC_GRAPH, a, *cap * sizeof(int)));
+    }
+    return a;
+}
+
+/* Create an empty spill file, or return NULL after printing why. */
+static spill *spill_create(void)
+{
+    FILE *file = tmpfile();
+    if (file == NULL) {
+        fprintf(stderr, "Failed to create shard spill file: %s\n", strerror(errno));
+        return NULL;
+    }
+    spill *s = check(alloc_calloc(ALLOC_GRAPH, 1, sizeof(spill)));
+    s->file = file;
+    s->pairs = check(alloc_malloc(ALLOC_GRAPH, 2 * SPILL_PAIRS * sizeof(int)));
+    return s;
+}
+
+/* Write the buffered pairs to the file. */
+static void spill_flush(spill *s)
+{
+    if (s->len > 0 && fwrite(s->pairs, sizeof(int), s->len, s->file) != (size_t)s->len) {
+        s->failed = true;
+    }
+    s->len = 0;
+}
+
+/* Add an edge to the end of the file. */
+static void spill_put(spill *s, int from, int to)
+{
+    if (s->len == 2 * SPILL_PAIRS) {
+        spill_flush(s);
+    }
+    s->pairs[s->len++] = from;
+    s->pairs[s->len++] = to;
+}
+
+/* Go back to the first edge. False after printing why if a write failed. */
+static bool spill_rewind(spill *s)
+{
+    spill_flush(s);
+    if (s->failed || fflush(s->file) != 0) {
+        fprintf(stderr, "Failed to write shard spill file: %s\n", strerror(errno));
+        return false;
+    }
+    rewind(s->file);
+    s->len = 0;
+    s->pos = 0;
+    return true;
+}
+
+/* Read the next edge. False at the end of the file. */
+static bool spill_get(spill *s, int *from, int *to)
+{
+    if (s->pos == s->len) {
+        s->len = fread(s->pairs, sizeof(int), 2 * SPILL_PAIRS, s->file) & ~1;
+        s->pos = 0;
+        if (s->len == 0) {
+            return false;
+        }
+    }
+    *from = s->pairs[s->pos++];
+    *to = s->pairs[s->pos++];
+    return true;
+}
+
+/* Delete the file. */
+static void spill_close(spill *s)
+{
+    if (s != NULL) {
+        fclose(s->file);
+        alloc_free(s->pairs);
+        alloc_free(s);
+    }
+}
+
+// State while the map is streamed into the spill file.
+typedef struct reader {
+    cluster *c;
+    spill *edges;
+    int *degree;       // Out-edges of each node, repeats included.
+    int degreeCap;
+} reader;
+
+/* Edge callback: name both cities and spill the edge. */
+static void spill_edge(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    reader *r = ctx;
+    int ids[2];
+    for (int i = 0; i < 2; i++) {
+        bool added;
+        ids[i] = strtab_intern(r->c->names, i == 0 ? a : b, i == 0 ? alen : blen, &added);
+        if (added) {
+            r->degree = reserve(r->degree, &r->degreeCap, ids[i] + 1);
+            r->degree[ids[i]] = 0;
+        }
+    }
+    r->c->numEdges++;
+    // A node always reaches itself, the edge is not needed
+    if (ids[0] != ids[1]) {
+        r->degree[ids[0]]++;
+        spill_put(r->edges, ids[0], ids[1]);
+    }
+}
+
+/* Compare two ints for qsort(). */
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Worker: receive the shard. */
+static bool read_shard(int in, const request *req, shard *s)
+{
+    s->numNodes = req->count;
+    s->numEdges = req->to;
+    s->first = check(alloc_malloc(ALLOC_GRAPH, (s->numNodes + 1) * sizeof(int)));
+    s->targets = check(alloc_malloc(ALLOC_GRAPH, (s->numEdges + 1) * sizeof(int)));
+    s->mark = check(alloc_calloc(ALLOC_QUEUE, s->numNodes + 1, sizeof(uint32_t)));
+    s->queue = check(alloc_malloc(ALLOC_QUEUE, (s->numNodes + 1) * sizeof(int)));
+    return read_all(in, s->first, (s->numNodes + 1) * sizeof(int)) &&
+           read_all(in, s->targets, s->numEdges * sizeof(int));
+}
+
+/* Worker: search from the seeds as far as the shard reaches. */
+static bool step(int in, int out, const request *req, shard *s)
+{
+    if (req->query != s->query) {
+        s->query = req->query;
+        if (++s->stamp == 0) {
+            // The stamp wrapped, old marks could look current
+            memset(s->mark, 0, s->numNodes * sizeof(uint32_t));
+            s->stamp = 1;
+        }
+    }
+    int *seeds = check(alloc_malloc(ALLOC_QUEUE, (req->count + 1) * sizeof(int)));
+    if (!read_all(in, seeds, req->count * sizeof(int))) {
+        alloc_free(seeds);
+        return false;
+    }
+    reply rep;
+    memset(&rep, 0, sizeof(rep));
+    int head = 0;
+    int tail = 0;
+    for (int i = 0; i < req->count; i++) {
+        int u = seeds[i];
+        if (s->mark[u] != s->stamp) {
+            s->mark[u] = s->stamp;
+            s->queue[tail++] = u;
+            rep.found |= u == req->to;
+        }
+    }
+    alloc_free(seeds);
+    while (!rep.found && head < tail) {
+        int u = s->queue[head++];
+        rep.visited++;
+        for (int k = s->first[u]; k < s->first[u + 1]; k++) {
+            rep.edges++;
+            int t = s->targets[k];
+            if (t < 0) {
+                // Owned by another shard, the coordinator routes it
+                s->out = reserve(s->out, &s->outCap, rep.count + 1);
+                s->out[rep.count++] = -(t + 1);
+            } else if (s->mark[t] != s->stamp) {
+                s->mark[t] = s->stamp;
+                s->queue[tail++] = t;
+                if (t == req->to) {
+                    rep.found = 1;
+                    break;
+                }
+            }
+        }
+    }
+    if (rep.found) {
+        rep.count = 0;
+    }
+    if (rep.count > 1) {
+        qsort(s->out, rep.count, sizeof(int), compare_ints);
+    }
+    int unique = 0;
+    for (int i = 0; i < rep.count; i++) {
+        if (unique == 0 || s->out[i] != s->out[unique - 1]) {
+            s->out[unique++] = s->out[i];
+        }
+    }
+    rep.count = unique;
+    return write_all(out, &rep, sizeof(rep)) &&
+           write_all(out, s->out, rep.count * sizeof(int));
+}
+
+/* Worker: answer requests until the coordinator closes the pipe. */
+static void worker_main(int in, int out)
+{
+    shard s;
+    memset(&s, 0, sizeof(s));
+    request req;
+    bool ok = true;
+    while (ok && read_all(in, &req, sizeof(req))) {
+        if (req.op == OP_SHARD) {
+            ok = read_shard(in, &req, &s);
+        } else {
+            ok = step(in, out, &req, &s);
+        }
+    }
+    _exit(0);
+}
+
+/**
+ * cluster_start() - Start the worker processes.
+ * @shards: Number of shards, and so of workers.
+ *
+ * Call this before the graph is loaded so that the workers do not share
+ * its pages with the coordinator.
+ *
+ * Returns: A pointer to the new cluster, or NULL after printing an
+ * error message if the workers could not be started.
+ */
+cluster *cluster_start(int shards){
+    cluster *c = check(alloc_calloc(ALLOC_GRAPH, 1, sizeof(cluster)));
+    c->shards = shards;
+    c->workers = check(alloc_calloc(ALLOC_GRAPH, shards, sizeof(worker)));
+    // Nothing buffered may be written twice by the children
+    fflush(stdout);
+    fflush(stderr);
+    for (int i = 0; i < shards; i++)
+    {
+        int req[2];
+        int rep[2];
+        if (pipe(req) != 0)
+        {
+            fprintf(stderr, "Failed to start shard workers: %s\n", strerror(errno));
+            cluster_stop(c);
+            return NULL;
+        }
+        if (pipe(rep) != 0)
+        {
+            fprintf(stderr, "Failed to start shard workers: %s\n", strerror(errno));
+            close(req[0]);
+            close(req[1]);
+            cluster_stop(c);
+            return NULL;
+        }
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(req[1]);
+            close(rep[0]);
+            for (int j = 0; j < i; j++)
+            {
+                close(c->workers[j].requests);
+                close(c->workers[j].replies);
+            }
+            worker_main(req[0], rep[1]);
+        }
+        close(req[0]);
+        close(rep[1]);
+        if (pid < 0)
+        {
+            fprintf(stderr, "Failed to start shard workers: %s\n", strerror(errno));
+            close(req[1]);
+            close(rep[0]);
+            cluster_stop(c);
+            return NULL;
+        }
+        c->workers[i].pid = pid;
+        c->workers[i].requests = req[1];
+        c->workers[i].replies = rep[0];
+        c->started++;
+    }
+    return c;
+}
+
+/* Add an entry to a max-heap. */
+static void heap_push(long long *heap, int *size, long long entry)
+{
+    int i = (*size)++;
+    while (i > 0 && heap[(i - 1) / 2] < entry) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = entry;
+}
+
+/* Remove the largest entry of a max-heap. */
+static void heap_pop(long long *heap, int *size)
+{
+    long long last = heap[--(*size)];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= *size) {
+            break;
+        }
+        if (child + 1 < *size && heap[child + 1] > heap[child]) {
+            child++;
+        }
+        if (heap[child] <= last) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+}
+
+/* Split the nodes into parts with few edges between them. */
+static void partition(cluster *c, const int *first, const int *adj, const int *weight)
+{
+    int n = c->numNodes;
+    int k = c->shards;
+    long long total = 0;
+    for (int v = 0; v < n; v++)
+    {
+        total += weight[v];
+    }
+    long long target = (total + k - 1) / k;
+    long long limit = target + target / 20 + 1;
+    long long *partWeight = check(alloc_calloc(ALLOC_GRAPH, k, sizeof(long long)));
+
+    // Grow one part at a time, always adding the node with the most
+    // edges into the part, so that the parts follow dense regions.
+    // The heap holds (edges into the part, node) and may hold stale
+    // entries, which are skipped.
+    int *link = check(alloc_calloc(ALLOC_GRAPH, n + 1, sizeof(int)));
+    int *touched = check(alloc_malloc(ALLOC_GRAPH, (n + 1) * sizeof(int)));
+    long long *heap = check(alloc_malloc(ALLOC_GRAPH, ((size_t)first[n] + 1) * sizeof(long long)));
+    for (int v = 0; v < n; v++)
+    {
+        c->owner[v] = -1;
+    }
+    int seed = 0;
+    for (int part = 0; part < k; part++)
+    {
+        int numTouched = 0;
+        int size = 0;
+        while (part == k - 1 || partWeight[part] < target)
+        {
+            int v = -1;
+            while (size > 0 && v < 0)
+            {
+                v = heap[0] & 0xffffffff;
+                if (c->owner[v] >= 0 || link[v] != heap[0] >> 32)
+                {
+                    v = -1;
+                }
+                heap_pop(heap, &size);
+            }
+            if (v < 0)
+            {
+                // Nothing connected is left, start from a new node
+                while (seed < n && c->owner[seed] >= 0)
+                {
+                    seed++;
+                }
+                if (seed == n)
+                {
+                    break;
+                }
+                v = seed;
+            }
+            c->owner[v] = part;
+            partWeight[part] += weight[v];
+            for (int e = first[v]; e < first[v + 1]; e++)
+            {
+                int u = adj[e];
+                if (c->owner[u] < 0)
+                {
+                    if (link[u]++ == 0)
+                    {
+                        touched[numTouched++] = u;
+                    }
+                    heap_push(heap, &size, (long long)link[u] << 32 | u);
+                }
+            }
+        }
+        for (int t = 0; t < numTouched; t++)
+        {
+            link[touched[t]] = 0;
+        }
+    }
+    alloc_free(link);
+    alloc_free(touched);
+    alloc_free(heap);
+
+    // Move nodes to the part most of their neighbours are in
+    int *count = check(alloc_calloc(ALLOC_GRAPH, k, sizeof(int)));
+    int *parts = check(alloc_malloc(ALLOC_GRAPH, k * sizeof(int)));
+    for (int pass = 0; pass < REFINE_PASSES; pass++)
+    {
+        int moved = 0;
+        for (int v = 0; v < n; v++)
+        {
+            int numTouched = 0;
+            for (int e = first[v]; e < first[v + 1]; e++)
+            {
+                int p = c->owner[adj[e]];
+                if (count[p]++ == 0)
+                {
+                    parts[numTouched++] = p;
+                }
+            }
+            int cur = c->owner[v];
+            int best = cur;
+            for (int t = 0; t < numTouched; t++)
+            {
+                int p = parts[t];
+                if (count[p] > count[best] && partWeight[p] + weight[v] <= limit)
+                {
+                    best = p;
+                }
+            }
+            for (int t = 0; t < numTouched; t++)
+            {
+                count[parts[t]] = 0;
+            }
+            if (best != cur)
+            {
+                partWeight[cur] -= weight[v];
+                partWeight[best] += weight[v];
+                c->owner[v] = best;
+                moved++;
+            }
+        }
+        if (moved == 0)
+        {
+            break;
+        }
+    }
+    alloc_free(count);
+    alloc_free(parts);
+    alloc_free(partWeight);
+}
+
+/* Build shard p from its spilled edges and send it to its worker. */
+static int send_shard(cluster *c, int p, spill *edges, const int *degree,
+                      int size, int maxEdges, int *cut)
+{
+    int *shardFirst = check(alloc_malloc(ALLOC_GRAPH, (size + 1) * sizeof(int)));
+    int *at = check(alloc_malloc(ALLOC_GRAPH, (size + 1) * sizeof(int)));
+    int *shardTargets = check(alloc_malloc(ALLOC_GRAPH, (maxEdges + 1) * sizeof(int)));
+    int i = 0;
+    int m = 0;
+    for (int v = 0; v < c->numNodes; v++)
+    {
+        if (c->owner[v] == p)
+        {
+            shardFirst[i] = m;
+            at[i++] = m;
+            m += degree[v];
+        }
+    }
+    shardFirst[size] = m;
+    int from;
+    int to;
+    while (spill_get(edges, &from, &to))
+    {
+        shardTargets[at[c->local[from]]++] = to;
+    }
+    alloc_free(at);
+
+    // Keep each edge once, as graph_remove_duplicates() would
+    m = 0;
+    for (i = 0; i < size; i++)
+    {
+        int begin = shardFirst[i];
+        int end = shardFirst[i + 1];
+        if (end - begin > 1)
+        {
+            qsort(shardTargets + begin, end - begin, sizeof(int), compare_ints);
+        }
+        shardFirst[i] = m;
+        for (int k = begin; k < end; k++)
+        {
+            if (k == begin || shardTargets[k] != shardTargets[k - 1])
+            {
+                shardTargets[m++] = shardTargets[k];
+            }
+        }
+    }
+    shardFirst[size] = m;
+    for (int k = 0; k < m; k++)
+    {
+        int t = shardTargets[k];
+        *cut += c->owner[t] != p;
+        shardTargets[k] = c->owner[t] == p ? c->local[t] : -(t + 1);
+    }
+
+    request req = { OP_SHARD, 0, m, size };
+    if (!write_all(c->workers[p].requests, &req, sizeof(req)) ||
+        !write_all(c->workers[p].requests, shardFirst, (size + 1) * sizeof(int)) ||
+        !write_all(c->workers[p].requests, shardTargets, m * sizeof(int)))
+    {
+        lost_worker();
+    }
+    alloc_free(shardFirst);
+    alloc_free(shardTargets);
+    return m;
+}
+
+/**
+ * cluster_load() - Read a map, partition it and hand out the shards.
+ * @c: Started cluster.
+ * @src: Source of the map bytes. Not closed.
+ * @showStats: If true, print the size of the cut and of each shard.
+ *
+ * The edges are spilled to a temporary file as they are read, and no
+ * graph is built. The partitioner then needs both directions of every
+ * edge in memory. Each shard is built and sent in turn from its own
+ * spill file, so only one shard is held at a time.
+ *
+ * Returns: True if the shards were sent, or false after printing an
+ * error message if the map is badly formatted or could not be spilled.
+ */
+bool cluster_load(cluster *c, source *src, bool showStats){
+    c->names = strtab_empty(0);
+    reader r = { c, spill_create(), NULL, 0 };
+    if (r.edges == NULL)
+    {
+        return false;
+    }
+    if (!map_scan_source(src, READ_SIZE, spill_edge, &r) || !spill_rewind(r.edges))
+    {
+        spill_close(r.edges);
+        alloc_free(r.degree);
+        return false;
+    }
+    int n = strtab_size(c->names);
+    c->numNodes = n;
+
+    // The edges in both directions, for the partitioner
+    int *first = check(alloc_calloc(ALLOC_GRAPH, n + 2, sizeof(int)));
+    int from;
+    int to;
+    while (spill_get(r.edges, &from, &to))
+    {
+        first[from + 2]++;
+        first[to + 2]++;
+    }
+    for (int v = 0; v < n; v++)
+    {
+        first[v + 2] += first[v + 1];
+    }
+    int *adj = check(alloc_malloc(ALLOC_GRAPH, ((size_t)first[n + 1] + 1) * sizeof(int)));
+    spill_rewind(r.edges);
+    while (spill_get(r.edges, &from, &to))
+    {
+        adj[first[from + 1]++] = to;
+        adj[first[to + 1]++] = from;
+    }
+    int *weight = check(alloc_malloc(ALLOC_GRAPH, (n + 1) * sizeof(int)));
+    for (int v = 0; v < n; v++)
+    {
+        weight[v] = 1 + r.degree[v];
+    }
+    c->owner = check(alloc_malloc(ALLOC_GRAPH, (n + 1) * sizeof(int)));
+    c->local = check(alloc_malloc(ALLOC_GRAPH, (n + 1) * sizeof(int)));
+    partition(c, first, adj, weight);
+    alloc_free(first);
+    alloc_free(adj);
+    alloc_free(weight);
+
+    // Sort the edges into one spill file per shard
+    int *size = check(alloc_calloc(ALLOC_GRAPH, c->shards, sizeof(int)));
+    int *edges = check(alloc_calloc(ALLOC_GRAPH, c->shards, sizeof(int)));
+    for (int v = 0; v < n; v++)
+    {
+        c->local[v] = size[c->owner[v]]++;
+        edges[c->owner[v]] += r.degree[v];
+    }
+    spill **parts = check(alloc_calloc(ALLOC_GRAPH, c->shards, sizeof(spill *)));
+    bool ok = true;
+    for (int p = 0; p < c->shards && ok; p++)
+    {
+        parts[p] = spill_create();
+        ok = parts[p] != NULL;
+    }
+    spill_rewind(r.edges);
+    while (ok && spill_get(r.edges, &from, &to))
+    {
+        spill_put(parts[c->owner[from]], from, to);
+    }
+    spill_close(r.edges);
+    for (int p = 0; p < c->shards && ok; p++)
+    {
+        ok = spill_rewind(parts[p]);
+    }
+
+    // Send each worker its nodes in index order, with their out-edges
+    int cut = 0;
+    int kept = 0;
+    for (int p = 0; p < c->shards && ok; p++)
+    {
+        edges[p] = send_shard(c, p, parts[p], r.degree, size[p], edges[p], &cut);
+        kept += edges[p];
+        spill_close(parts[p]);
+        parts[p] = NULL;
+    }
+    for (int p = 0; p < c->shards; p++)
+    {
+        spill_close(parts[p]);
+    }
+    if (ok && showStats)
+    {
+        fprintf(stderr, "shards: parts=%d edges=%d cut=%d", c->shards, kept, cut);
+        for (int p = 0; p < c->shards; p++)
+        {
+            fprintf(stderr, " %d:%d/%d", p, size[p], edges[p]);
+        }
+        fprintf(stderr, "\n");
+    }
+    alloc_free(parts);
+    alloc_free(size);
+    alloc_free(edges);
+    alloc_free(r.degree);
+    c->mark = check(alloc_calloc(ALLOC_QUEUE, n + 1, sizeof(uint32_t)));
+    return ok;
+}
+
+/**
+ * cluster_node_count() - Return the number of nodes.
+ * @c: Loaded cluster.
+ *
+ * Returns: The number of nodes.
+ */
+int cluster_node_count(const cluster *c){
+    return c->numNodes;
+}
+
+/**
+ * cluster_edge_count() - Return the number of edges read from the map.
+ * @c: Loaded cluster.
+ *
+ * Returns: The number of edges.
+ */
+int cluster_edge_count(const cluster *c){
+    return c->numEdges;
+}
+
+/**
+ * cluster_lookup() - Find a node by its name.
+ * @c: Loaded cluster.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the node, or -1 if there is no such city.
+ */
+int cluster_lookup(const cluster *c, const char *name){
+    return strtab_lookup(c->names, name, strlen(name));
+}
+
+/* Queue a node for a search round in its shard, unless already reached. */
+static bool route(cluster *c, int v, int to)
+{
+    if (c->mark[v] == c->stamp)
+    {
+        return false;
+    }
+    c->mark[v] = c->stamp;
+    worker *w = &c->workers[c->owner[v]];
+    w->seeds = reserve(w->seeds, &w->seedCap, w->numSeeds + 1);
+    w->seeds[w->numSeeds++] = c->local[v];
+    return v == to;
+}
+
+/**
+ * cluster_find_path() - Check for a path between two nodes.
+ * @c: Loaded cluster.
+ * @from: Index of the origin node.
+ * @to: Index of the destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The frontier peak counts the nodes passed between shards in a round.
+ * If stats is given it is overwritten with the cost of this search.
+ *
+ * Returns: True if a path exists from the origin to the destination.
+ */
+bool cluster_find_path(cluster *c, int from, int to, search_stats *stats){
+    search_stats st;
+    stats_reset(&st);
+    st.queries = 1;
+    double start = stats_now();
+
+    if (++c->stamp == 0)
+    {
+        // The stamp wrapped, old marks could look current
+        memset(c->mark, 0, c->numNodes * sizeof(uint32_t));
+        c->stamp = 1;
+    }
+    c->query++;
+    bool found = route(c, from, to);
+    st.frontier_peak = 1;
+    while (!found)
+    {
+        // Send the round to every shard that has something to search
+        bool any = false;
+        for (int p = 0; p < c->shards; p++)
+        {
+            worker *w = &c->workers[p];
+            w->active = w->numSeeds > 0;
+            if (!w->active)
+            {
+                continue;
+            }
+            request req = { OP_STEP, c->query, c->owner[to] == p ? c->local[to] : -1, w->numSeeds };
+            if (!write_all(w->requests, &req, sizeof(req)) ||
+                !write_all(w->requests, w->seeds, w->numSeeds * sizeof(int)))
+            {
+                lost_worker();
+            }
+            w->numSeeds = 0;
+            any = true;
+        }
+        if (!any)
+        {
+            break;
+        }
+        // Collect the nodes the shards reached in other shards. Every
+        // reply is read, even after the destination has been found.
+        unsigned long routed = 0;
+        for (int p = 0; p < c->shards; p++)
+        {
+            worker *w = &c->workers[p];
+            if (!w->active)
+            {
+                continue;
+            }
+            reply rep;
+            if (!read_all(w->replies, &rep, sizeof(rep)))
+            {
+                lost_worker();
+            }
+            c->found = reserve(c->found, &c->foundCap, rep.count);
+            if (!read_all(w->replies, c->found, rep.count * sizeof(int)))
+            {
+                lost_worker();
+            }
+            st.nodes_visited += rep.visited;
+            st.edges_relaxed += rep.edges;
+            found |= rep.found;
+            for (int i = 0; i < rep.count; i++)
+            {
+                if (c->mark[c->found[i]] != c->stamp)
+                {
+                    routed++;
+                }
+                found |= route(c, c->found[i], to);
+            }
+        }
+        if (routed > st.frontier_peak)
+        {
+            st.frontier_peak = routed;
+        }
+    }
+    for (int p = 0; p < c->shards; p++)
+    {
+        c->workers[p].numSeeds = 0;
+    }
+    st.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    return found;
+}
+
+/**
+ * cluster_stop() - Stop the workers and destroy the cluster.
+ * @c: Cluster to destroy.
+ *
+ * Returns: Nothing.
+ */
+void cluster_stop(cluster *c){
+    // A worker stops when its request pipe is closed
+    for (int i = 0; i < c->started; i++)
+    {
+        close(c->workers[i].requests);
+        close(c->workers[i].replies);
+    }
+    for (int i = 0; i < c->started; i++)
+    {
+        waitpid(c->workers[i].pid, NULL, 0);
+        alloc_free(c->workers[i].seeds);
+    }
+    if (c->names != NULL)
+    {
+        strtab_kill(c->names, true);
+    }
+    alloc_free(c->workers);
+    alloc_free(c->owner);
+    alloc_free(c->local);
+    alloc_free(c->mark);
+    alloc_free(c->found);
+    alloc_free(c);
+}
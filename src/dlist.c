@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "dlist.h"
 
 /*
@@ -48,10 +49,10 @@ struct dlist {
 dlist *dlist_empty(free_function free_func)
 {
 	// Allocate memory for the list structure.
-	dlist *l = calloc(1, sizeof(*l));
+	dlist *l = alloc_calloc(ALLOC_DLIST, 1, sizeof(*l));
 
 	// Allocate memory for the list head.
-	l->head = calloc(1, sizeof(struct cell));
+	l->head = alloc_calloc(ALLOC_DLIST, 1, sizeof(struct cell));
 	
 	// No elements in list so far.
 	l->head->next = NULL;
@@ -148,7 +149,7 @@ void *dlist_inspect(const dlist *l, const dlist_pos p)
 dlist_pos dlist_insert(dlist *l, void *v, const dlist_pos p)
 {
 	// Create new element.
-	dlist_pos new_pos=calloc(1, sizeof(struct cell));
+	dlist_pos new_pos=alloc_calloc(ALLOC_DLIST, 1, sizeof(struct cell));
 	// Set value.
 	new_pos->value=v;
 
@@ -184,7 +185,7 @@ dlist_pos dlist_remove(dlist *l, const dlist_pos p)
 		l->free_func(c->value);
 	}
 	// Free the memory allocated to the cell itself.
-	free(c);
+	alloc_free(c);
 	// Return the position of the next element.
 	return p;
 }
@@ -213,8 +214,8 @@ void dlist_kill(dlist *l)
 	}
 
 	// Free the head and the list itself.
-	free(l->head);
-	free(l);    
+	alloc_free(l->head);
+	alloc_free(l);    
 }
 
 /**
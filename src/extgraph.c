@@ -0,0 +1,651 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "alloc.h"
+#include "strtab.h"
+#include "loader.h"
+#include "extgraph.h"
+
+/*
+ * Implementation of the external memory graph.
+ */
+
+// Smallest file buffer and sort buffer, however small the budget.
+#define MIN_IO 512
+#define MIN_KEYS 16
+// Largest file buffer. More memory goes to the sort buffers instead.
+#define MAX_IO (1 << 20)
+
+// A file read or written sequentially through a buffer. The buffer is
+// only held while the file is in use, so that many sorted runs can wait
+// for their merge without taking memory.
+typedef struct stream {
+    int fd;
+    char *buf;
+    size_t cap;
+    size_t len;        // Bytes in buf when reading.
+    size_t pos;        // Next byte in buf to read or write.
+    bool writing;
+} stream;
+
+// Collects keys and hands them back sorted, without duplicates. Keys
+// that do not fit in the buffer are sorted in runs on disk.
+typedef struct sorter {
+    extgraph *eg;
+    uint64_t *keys;
+    size_t cap;
+    size_t len;
+    stream **runs;     // Sorted runs, each key stored as a varint delta.
+    int numRuns;
+    int runCap;
+    stream *out;       // The merged result, or NULL if it is in keys.
+    uint64_t last;     // Last key read from out.
+    size_t pos;        // Next key to read from keys.
+} sorter;
+
+struct extgraph {
+    char *dir;
+    size_t ioSize;     // Size of each file buffer.
+    size_t numKeys;    // Size of each sort buffer, in keys.
+    int fanIn;         // Runs merged at a time.
+    strtab *names;
+    int numEdges;
+    stream *adj;       // The adjacency file.
+    unsigned char *visited;
+    sorter *frontier;
+    sorter *next;
+};
+
+/* Abort when a file that is needed can not be used any more. */
+static void io_failed(const char *what)
+{
+    fprintf(stderr, "Failed to %s external graph file: %s\n", what, strerror(errno));
+    exit(EXIT_FAILURE);
+}
+
+/* Create an anonymous file in the directory, or return -1. */
+static int temp_file(const char *dir)
+{
+    char path[PATH_MAX];
+    if ((size_t)snprintf(path, sizeof(path), "%s/isconnected.XXXXXX", dir) >= sizeof(path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        // The file goes away by itself when it is closed
+        unlink(path);
+    }
+    return fd;
+}
+
+/* Open a stream on a new anonymous file. */
+static stream *stream_create(const extgraph *eg)
+{
+    int fd = temp_file(eg->dir);
+    if (fd < 0) {
+        io_failed("create");
+    }
+    stream *s = check(alloc_calloc(ALLOC_LOADER, 1, sizeof(stream)));
+    s->fd = fd;
+    s->cap = eg->ioSize;
+    s->writing = true;
+    return s;
+}
+
+/* Write out the buffered bytes. */
+static void stream_flush(stream *s)
+{
+    size_t done = 0;
+    while (done < s->pos) {
+        ssize_t n = write(s->fd, s->buf + done, s->pos - done);
+        if (n < 0 && errno != EINTR) {
+            io_failed("write");
+        }
+        done += n > 0 ? n : 0;
+    }
+    s->pos = 0;
+}
+
+/* Append one byte. */
+static void stream_putc(stream *s, unsigned char c)
+{
+    if (s->buf == NULL) {
+        s->buf = check(alloc_malloc(ALLOC_LOADER, s->cap));
+    }
+    if (s->pos == s->cap) {
+        stream_flush(s);
+    }
+    s->buf[s->pos++] = c;
+}
+
+/* Read the next byte, or return -1 at the end of the file. */
+static int stream_getc(stream *s)
+{
+    if (s->pos == s->len) {
+        ssize_t n;
+        while ((n = read(s->fd, s->buf, s->cap)) < 0) {
+            if (errno != EINTR) {
+                io_failed("read");
+            }
+        }
+        if (n == 0) {
+            return -1;
+        }
+        s->len = n;
+        s->pos = 0;
+    }
+    return (unsigned char)s->buf[s->pos++];
+}
+
+/* Finish writing and free the buffer until the stream is read. */
+static void stream_park(stream *s)
+{
+    if (s->writing) {
+        stream_flush(s);
+        s->writing = false;
+    }
+    alloc_free(s->buf);
+    s->buf = NULL;
+}
+
+/* Start reading from the beginning of the file. */
+static void stream_rewind(stream *s)
+{
+    if (s->writing) {
+        stream_flush(s);
+        s->writing = false;
+    }
+    if (s->buf == NULL) {
+        s->buf = check(alloc_malloc(ALLOC_LOADER, s->cap));
+    }
+    if (lseek(s->fd, 0, SEEK_SET) < 0) {
+        io_failed("rewind");
+    }
+    s->len = 0;
+    s->pos = 0;
+}
+
+/* Close the file and free the stream. */
+static void stream_close(stream *s)
+{
+    close(s->fd);
+    alloc_free(s->buf);
+    alloc_free(s);
+}
+
+/* Append a number in 7-bit groups, low group first. */
+static void put_varint(stream *s, uint64_t v)
+{
+    while (v >= 0x80) {
+        stream_putc(s, (unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    stream_putc(s, (unsigned char)v);
+}
+
+/* Read a number written by put_varint(). Returns false at the end. */
+static bool get_varint(stream *s, uint64_t *v)
+{
+    int c = stream_getc(s);
+    if (c < 0) {
+        return false;
+    }
+    uint64_t value = c & 0x7f;
+    for (int shift = 7; c & 0x80; shift += 7) {
+        c = stream_getc(s);
+        if (c < 0 || shift > 63) {
+            errno = EIO;
+            io_failed("decode");
+        }
+        value |= (uint64_t)(c & 0x7f) << shift;
+    }
+    *v = value;
+    return true;
+}
+
+/* Compare two keys for qsort(). */
+static int compare_keys(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/* Create an empty sorter. */
+static sorter *sorter_empty(extgraph *eg)
+{
+    sorter *s = check(alloc_calloc(ALLOC_LOADER, 1, sizeof(sorter)));
+    s->eg = eg;
+    s->cap = eg->numKeys;
+    s->keys = check(alloc_malloc(ALLOC_LOADER, s->cap * sizeof(uint64_t)));
+    return s;
+}
+
+/* Sort the buffered keys and drop the duplicates. */
+static void sort_buffer(sorter *s)
+{
+    qsort(s->keys, s->len, sizeof(uint64_t), compare_keys);
+    size_t unique = 0;
+    for (size_t i = 0; i < s->len; i++) {
+        if (unique == 0 || s->keys[i] != s->keys[unique - 1]) {
+            s->keys[unique++] = s->keys[i];
+        }
+    }
+    s->len = unique;
+}
+
+/* Add a finished run. */
+static void add_run(sorter *s, stream *run)
+{
+    if (s->numRuns == s->runCap) {
+        s->runCap = s->runCap ? 2 * s->runCap : 16;
+        s->runs = check(alloc_realloc(ALLOC_LOADER, s->runs, s->runCap * sizeof(stream *)));
+    }
+    s->runs[s->numRuns++] = run;
+}
+
+/* Write the buffered keys to disk as a sorted run. */
+static void spill(sorter *s)
+{
+    sort_buffer(s);
+    stream *run = stream_create(s->eg);
+    uint64_t last = 0;
+    for (size_t i = 0; i < s->len; i++) {
+        put_varint(run, s->keys[i] - last);
+        last = s->keys[i];
+    }
+    stream_park(run);
+    add_run(s, run);
+    s->len = 0;
+}
+
+/* Merge count runs into one, reading each of them once. */
+static stream *merge(sorter *s, stream **runs, int count)
+{
+    uint64_t *head = check(alloc_malloc(ALLOC_LOADER, count * sizeof(uint64_t)));
+    bool *more = check(alloc_malloc(ALLOC_LOADER, count * sizeof(bool)));
+    for (int i = 0; i < count; i++) {
+        stream_rewind(runs[i]);
+        more[i] = get_varint(runs[i], &head[i]);
+    }
+    stream *out = stream_create(s->eg);
+    uint64_t last = 0;
+    bool any = false;
+    for (;;) {
+        int min = -1;
+        for (int i = 0; i < count; i++) {
+            if (more[i] && (min < 0 || head[i] < head[min])) {
+                min = i;
+            }
+        }
+        if (min < 0) {
+            break;
+        }
+        if (!any || head[min] != last) {
+            put_varint(out, head[min] - last);
+            last = head[min];
+            any = true;
+        }
+        uint64_t delta;
+        more[min] = get_varint(runs[min], &delta);
+        head[min] += delta;
+    }
+    for (int i = 0; i < count; i++) {
+        stream_close(runs[i]);
+    }
+    alloc_free(head);
+    alloc_free(more);
+    stream_park(out);
+    return out;
+}
+
+/* Add a key. */
+static void sorter_add(sorter *s, uint64_t key)
+{
+    if (s->len == s->cap) {
+        spill(s);
+    }
+    s->keys[s->len++] = key;
+}
+
+/* Stop adding keys and prepare to read them in order. */
+static void sorter_finish(sorter *s)
+{
+    s->pos = 0;
+    if (s->numRuns == 0) {
+        // Everything fit in memory, no file is needed
+        sort_buffer(s);
+        return;
+    }
+    if (s->len > 0) {
+        spill(s);
+    }
+    // Merge fanIn runs at a time until one run is left
+    while (s->numRuns > 1) {
+        int count = 0;
+        for (int i = 0; i < s->numRuns; i += s->eg->fanIn) {
+            int n = s->numRuns - i < s->eg->fanIn ? s->numRuns - i : s->eg->fanIn;
+            s->runs[count++] = n == 1 ? s->runs[i] : merge(s, s->runs + i, n);
+        }
+        s->numRuns = count;
+    }
+    s->out = s->runs[0];
+    s->numRuns = 0;
+    s->last = 0;
+    stream_rewind(s->out);
+}
+
+/* Read the next key. Returns false when there are no more keys. */
+static bool sorter_next(sorter *s, uint64_t *key)
+{
+    if (s->out == NULL) {
+        if (s->pos == s->len) {
+            return false;
+        }
+        *key = s->keys[s->pos++];
+        return true;
+    }
+    uint64_t delta;
+    if (!get_varint(s->out, &delta)) {
+        return false;
+    }
+    s->last += delta;
+    *key = s->last;
+    return true;
+}
+
+/* Forget all keys. */
+static void sorter_reset(sorter *s)
+{
+    for (int i = 0; i < s->numRuns; i++) {
+        stream_close(s->runs[i]);
+    }
+    if (s->out != NULL) {
+        stream_close(s->out);
+        s->out = NULL;
+    }
+    s->numRuns = 0;
+    s->len = 0;
+    s->pos = 0;
+}
+
+/* Destroy a sorter. */
+static void sorter_kill(sorter *s)
+{
+    sorter_reset(s);
+    alloc_free(s->runs);
+    alloc_free(s->keys);
+    alloc_free(s);
+}
+
+// State of the map parser.
+typedef struct parse_state {
+    extgraph *eg;
+    sorter *edges;
+} parse_state;
+
+/* Edge callback: intern the names and add the edge to the sort. */
+static void parse_edge(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    parse_state *ps = ctx;
+    uint64_t from = strtab_intern(ps->eg->names, a, alen, NULL);
+    uint64_t to = strtab_intern(ps->eg->names, b, blen, NULL);
+    sorter_add(ps->edges, from << 32 | to);
+    ps->eg->numEdges++;
+}
+
+/* Write the sorted edges as adjacency records. */
+static void write_adjacency(extgraph *eg, sorter *edges)
+{
+    uint64_t key;
+    uint64_t prevNode = 0;
+    uint64_t prevNeighbour = 0;
+    int64_t current = -1;
+    while (sorter_next(edges, &key)) {
+        uint64_t from = key >> 32;
+        uint64_t to = key & 0xffffffffu;
+        if ((int64_t)from != current) {
+            if (current >= 0) {
+                put_varint(eg->adj, 0);
+            }
+            put_varint(eg->adj, from - prevNode);
+            put_varint(eg->adj, to + 1);
+            prevNode = from;
+            current = from;
+        } else {
+            put_varint(eg->adj, to - prevNeighbour);
+        }
+        prevNeighbour = to;
+    }
+    if (current >= 0) {
+        put_varint(eg->adj, 0);
+    }
+    stream_park(eg->adj);
+}
+
+/**
+ * extgraph_build() - Sort a map into an external memory graph.
+ * @src: Source of the map bytes. Not closed.
+ * @dir: Directory for the adjacency and temporary files.
+ * @budget: Bytes of memory to use for buffers.
+ *
+ * Lines are handled by the same rules as when the map is loaded into
+ * memory. Duplicate edges are kept only once.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted or a file could not be used.
+ */
+extgraph *extgraph_build(source *src, const char *dir, size_t budget){
+    // Check the directory before reading anything
+    int fd = temp_file(dir);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to create files in %s: %s\n", dir, strerror(errno));
+        return NULL;
+    }
+    close(fd);
+
+    extgraph *eg = check(alloc_calloc(ALLOC_LOADER, 1, sizeof(extgraph)));
+    eg->dir = check(alloc_malloc(ALLOC_LOADER, strlen(dir) + 1));
+    strcpy(eg->dir, dir);
+    // A quarter of the budget for each of the two sort buffers, the
+    // rest for the file buffers of a search and a merge
+    eg->ioSize = budget / 16;
+    eg->ioSize = eg->ioSize < MIN_IO ? MIN_IO : eg->ioSize > MAX_IO ? MAX_IO : eg->ioSize;
+    eg->numKeys = budget / 4 / sizeof(uint64_t);
+    eg->numKeys = eg->numKeys < MIN_KEYS ? MIN_KEYS : eg->numKeys;
+    eg->fanIn = budget / 4 / eg->ioSize - 1;
+    eg->fanIn = eg->fanIn < 2 ? 2 : eg->fanIn;
+    eg->names = strtab_empty(0);
+    eg->adj = stream_create(eg);
+
+    parse_state ps;
+    memset(&ps, 0, sizeof(ps));
+    ps.eg = eg;
+    ps.edges = sorter_empty(eg);
+    if (!map_scan_source(src, eg->ioSize, parse_edge, &ps))
+    {
+        sorter_kill(ps.edges);
+        extgraph_kill(eg);
+        return NULL;
+    }
+    sorter_finish(ps.edges);
+    write_adjacency(eg, ps.edges);
+    sorter_kill(ps.edges);
+
+    int n = strtab_size(eg->names);
+    eg->visited = check(alloc_malloc(ALLOC_QUEUE, n / 8 + 1));
+    eg->frontier = sorter_empty(eg);
+    eg->next = sorter_empty(eg);
+    return eg;
+}
+
+/**
+ * extgraph_node_count() - Return the number of nodes.
+ * @eg: Graph to inspect.
+ *
+ * Returns: The number of nodes.
+ */
+int extgraph_node_count(const extgraph *eg){
+    return strtab_size(eg->names);
+}
+
+/**
+ * extgraph_edge_count() - Return the number of edges read from the map.
+ * @eg: Graph to inspect.
+ *
+ * Returns: The number of edges.
+ */
+int extgraph_edge_count(const extgraph *eg){
+    return eg->numEdges;
+}
+
+/**
+ * extgraph_lookup() - Find a node by its name.
+ * @eg: Graph to inspect.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the node, or -1 if there is no such city.
+ */
+int extgraph_lookup(const extgraph *eg, const char *name){
+    return strtab_lookup(eg->names, name, strlen(name));
+}
+
+/* Skip the rest of an adjacency record. */
+static void skip_record(stream *adj)
+{
+    uint64_t delta;
+    do {
+        if (!get_varint(adj, &delta)) {
+            errno = EIO;
+            io_failed("decode");
+        }
+    } while (delta != 0);
+}
+
+/**
+ * extgraph_find_path() - Check for a path between two nodes.
+ * @eg: Graph to search.
+ * @from: Index of the origin node.
+ * @to: Index of the destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The search stops as soon as the destination is reached. If stats is
+ * given it is overwritten with the cost of this search.
+ *
+ * Returns: True if a path exists from the origin to the destination.
+ */
+bool extgraph_find_path(extgraph *eg, int from, int to, search_stats *stats){
+    search_stats st;
+    stats_reset(&st);
+    st.queries = 1;
+    double start = stats_now();
+
+    bool found = from == to;
+    memset(eg->visited, 0, strtab_size(eg->names) / 8 + 1);
+    eg->visited[from / 8] |= 1 << (from % 8);
+    sorter_reset(eg->frontier);
+    sorter_add(eg->frontier, from);
+    sorter_finish(eg->frontier);
+    st.frontier_peak = 1;
+    while (!found)
+    {
+        // Expand one level: the frontier and the adjacency file are both
+        // sorted by node, so one pass over each is enough
+        stream_rewind(eg->adj);
+        sorter_reset(eg->next);
+        unsigned long added = 0;
+        uint64_t node = 0;
+        bool inRecord = false;
+        bool end = false;
+        uint64_t u;
+        while (!found && sorter_next(eg->frontier, &u))
+        {
+            st.nodes_visited++;
+            while (!end && (!inRecord || node < u))
+            {
+                if (inRecord)
+                {
+                    skip_record(eg->adj);
+                }
+                uint64_t gap;
+                end = !get_varint(eg->adj, &gap);
+                node += gap;
+                inRecord = !end;
+            }
+            if (!inRecord || node != u)
+            {
+                continue;
+            }
+            uint64_t delta;
+            uint64_t v = 0;
+            bool first = true;
+            while (get_varint(eg->adj, &delta) && delta != 0)
+            {
+                v = first ? delta - 1 : v + delta;
+                first = false;
+                st.edges_relaxed++;
+                if (!(eg->visited[v / 8] & (1 << (v % 8))))
+                {
+                    eg->visited[v / 8] |= 1 << (v % 8);
+                    sorter_add(eg->next, v);
+                    added++;
+                    if (v == (uint64_t)to)
+                    {
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            inRecord = false;
+        }
+        if (added > st.frontier_peak)
+        {
+            st.frontier_peak = added;
+        }
+        if (found || added == 0)
+        {
+            break;
+        }
+        sorter_finish(eg->next);
+        sorter *tmp = eg->frontier;
+        eg->frontier = eg->next;
+        eg->next = tmp;
+    }
+    // Give back the buffers of the last level until the next search
+    stream_park(eg->adj);
+    sorter_reset(eg->frontier);
+    sorter_reset(eg->next);
+    st.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    return found;
+}
+
+/**
+ * extgraph_kill() - Destroy a graph and close its files.
+ * @eg: Graph to destroy.
+ *
+ * Returns: Nothing.
+ */
+void extgraph_kill(extgraph *eg){
+    if (eg->frontier != NULL)
+    {
+        sorter_kill(eg->frontier);
+        sorter_kill(eg->next);
+    }
+    stream_close(eg->adj);
+    strtab_kill(eg->names, true);
+    alloc_free(eg->visited);
+    alloc_free(eg->dir);
+    alloc_free(eg);
+}
@@ -0,0 +1,198 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "alloc.h"
+#include "loader.h"
+#include "follow.h"
+
+/*
+ * Implementation of the map file follower.
+ */
+
+// Bytes read from the file at a time.
+#define READ_SIZE (1 << 16)
+
+struct follower {
+    int fd;
+    int notify;        // inotify descriptor, or -1 to poll the size.
+    off_t offset;      // Bytes of the file handled so far.
+    bool changed;      // Read on the next poll even without an event.
+    bool skipLine;     // Drop the rest of a line that was loaded partially.
+    char *buf;
+    carry carry;       // Start of a line that has no newline yet.
+};
+
+// Passes edges on to the caller's callback and counts them.
+typedef struct counter {
+    edge_callback cb;
+    void *ctx;
+    int edges;
+} counter;
+
+/* Edge callback: count the edge and hand it on. */
+static void count_edge(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    counter *c = ctx;
+    c->edges++;
+    c->cb(c->ctx, a, alen, b, blen);
+}
+
+/* Parse one complete line, skipping it if it is badly formatted. */
+static void parse_line(const char *s, size_t len, counter *c)
+{
+    if (!map_scan_lines(s, s + len, count_edge, c)) {
+        fprintf(stderr, "ERROR: Bad file format, skipped appended line: %.*s",
+                (int)len, s);
+    }
+}
+
+/* Split newly read bytes into lines and parse the complete ones. */
+static void consume(follower *f, const char *p, const char *end, counter *c)
+{
+    if (f->skipLine) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            return;
+        }
+        p = nl + 1;
+        f->skipLine = false;
+    }
+    while (p < end) {
+        const char *nl = memchr(p, '\n', end - p);
+        if (nl == NULL) {
+            carry_append(&f->carry, p, end - p);
+            return;
+        }
+        if (f->carry.len > 0) {
+            carry_append(&f->carry, p, nl + 1 - p);
+            parse_line(f->carry.buf, f->carry.len, c);
+            f->carry.len = 0;
+        } else {
+            parse_line(p, nl + 1 - p, c);
+        }
+        p = nl + 1;
+    }
+}
+
+/**
+ * follow_start() - Start following a loaded map file.
+ * @in: The map file, positioned after the bytes that have been loaded.
+ * @file: Name of the map file, for inotify.
+ *
+ * Returns: A pointer to the new follower, or NULL after printing an
+ * error message if the file is not a regular file.
+ */
+follower *follow_start(FILE *in, const char *file){
+    struct stat st;
+    int fd = fileno(in);
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        fprintf(stderr, "ERROR: Only a regular, uncompressed map file can be followed!\n");
+        return NULL;
+    }
+    follower *f = check(alloc_calloc(ALLOC_LOADER, 1, sizeof(follower)));
+    f->fd = fd;
+    f->buf = check(alloc_malloc(ALLOC_LOADER, READ_SIZE));
+    f->offset = lseek(fd, 0, SEEK_CUR);
+    if (f->offset < 0)
+    {
+        f->offset = st.st_size;
+    }
+    // A last line without a newline has been loaded already, so what
+    // is appended to it must not be taken as a new line
+    char last;
+    if (f->offset > 0 && pread(fd, &last, 1, f->offset - 1) == 1 && last != '\n')
+    {
+        f->skipLine = true;
+    }
+    f->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (f->notify >= 0 && inotify_add_watch(f->notify, file, IN_MODIFY) < 0)
+    {
+        close(f->notify);
+        f->notify = -1;
+    }
+    // Lines may have been appended while the map was loaded
+    f->changed = true;
+    return f;
+}
+
+/**
+ * follow_poll() - Parse the lines appended since the last call.
+ * @f: Follower to poll.
+ * @cb: Function called with the two city names of each new edge.
+ * @ctx: Passed on to cb.
+ *
+ * Cheap when nothing has changed: one non-blocking read from inotify,
+ * or one fstat() in the polling fallback.
+ *
+ * Returns: The number of edges passed to cb.
+ */
+int follow_poll(follower *f, edge_callback cb, void *ctx){
+    struct stat st;
+    if (f->notify >= 0)
+    {
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        while (read(f->notify, events, sizeof(events)) > 0)
+        {
+            f->changed = true;
+        }
+    }
+    else if (fstat(f->fd, &st) == 0 && st.st_size != f->offset)
+    {
+        f->changed = true;
+    }
+    if (!f->changed)
+    {
+        return 0;
+    }
+    f->changed = false;
+
+    if (fstat(f->fd, &st) == 0 && st.st_size < f->offset)
+    {
+        // Edges already in the graph can not be taken back
+        fprintf(stderr, "follow: map file was truncated, following from its new end\n");
+        f->offset = st.st_size;
+        f->carry.len = 0;
+        f->skipLine = false;
+    }
+    counter c = { cb, ctx, 0 };
+    ssize_t n;
+    while ((n = pread(f->fd, f->buf, READ_SIZE, f->offset)) != 0)
+    {
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            fprintf(stderr, "Failed to read map: %s\n", strerror(errno));
+            break;
+        }
+        f->offset += n;
+        consume(f, f->buf, f->buf + n, &c);
+    }
+    return c.edges;
+}
+
+/**
+ * follow_stop() - Stop following. The map file is not closed.
+ * @f: Follower to destroy.
+ *
+ * Returns: Nothing.
+ */
+void follow_stop(follower *f){
+    if (f->notify >= 0)
+    {
+        close(f->notify);
+    }
+    alloc_free(f->carry.buf);
+    alloc_free(f->buf);
+    alloc_free(f);
+}
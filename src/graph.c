@@ -2,39 +2,268 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include "alloc.h"
 #include "util.h"
 #include "dlist.h"
 #include "graph.h"
 #include "array_1d.h"
+#include "unionfind.h"
+
+// Bits in a word of the matrix, which is one element of its array_2d.
+#define WORD_BITS (8 * (int)sizeof(uintptr_t))
+
+// Neighbour IDs of one node in one direction.
+typedef struct idlist {
+    graph_id *ids;     // In insertion order. NULL once compact or a matrix.
+    int count;
+    int room;          // Number of slots in ids.
+} idlist;
+
+// The lists of all nodes in one direction, after graph_compact() or
+// graph_choose_matrix().
+typedef struct packing {
+    unsigned char *bytes;  // NULL unless compact.
+    size_t *at;            // Node i has bytes[at[i]..at[i+1]).
+    array_2d *bits;        // NULL unless a matrix. Row i holds node i.
+} packing;
 
 struct graph
 {
     array_1d *cities;
-    int size;
-    int freeIndex;
+    int capacity;      // Number of slots in cities.
+    int freeIndex;     // Number of inserted nodes.
+    bool hasIn;        // In-edges are kept, see graph_keep_in_edges().
+    packing out;
+    packing in;
+    int numComponents; // 0 unless labelled, see graph_label_components().
+    int *componentSize;
 };
 
 struct node
 {
     const char *name;
     int index;
-    dlist *neighbours;
+    idlist out;
+    idlist in;         // Empty unless the graph keeps in-edges.
+    int component;     // Valid while the graph is labelled.
     bool seen;
 };
 
+/* Order node IDs ascending, for qsort(). */
+static int compare_id(const void *a, const void *b)
+{
+    graph_id x = *(const graph_id *)a;
+    graph_id y = *(const graph_id *)b;
+    return (x > y) - (x < y);
+}
+
+/* Append v to buf as a varint, 7 bits per byte, low bits first. */
+static size_t put_varint(unsigned char *buf, uint64_t v)
+{
+    size_t len = 0;
+    while (v >= 0x80) {
+        buf[len++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    buf[len++] = (unsigned char)v;
+    return len;
+}
+
+/* Read a varint written by put_varint() and step past it. */
+static uint64_t get_varint(const unsigned char **pos)
+{
+    const unsigned char *p = *pos;
+    uint64_t v = *p & 0x7f;
+    for (int shift = 7; *p++ & 0x80; shift += 7) {
+        v |= (uint64_t)(*p & 0x7f) << shift;
+    }
+    *pos = p;
+    return v;
+}
+
+/* Add id to the end of l. */
+static void append_id(idlist *l, graph_id id)
+{
+    if (l->count == l->room) {
+        l->room = l->room ? 2 * l->room : 2;
+        l->ids = check(alloc_realloc(ALLOC_GRAPH, l->ids, l->room * sizeof(graph_id)));
+    }
+    l->ids[l->count++] = id;
+}
+
+/* Sort l and drop repeated IDs and self, returning how many went. */
+static int drop_duplicates(idlist *l, graph_id self)
+{
+    if (l->count > 1) {
+        qsort(l->ids, l->count, sizeof(graph_id), compare_id);
+    }
+    int kept = 0;
+    for (int k = 0; k < l->count; k++) {
+        graph_id id = l->ids[k];
+        if (id != self && (kept == 0 || l->ids[kept - 1] != id)) {
+            l->ids[kept++] = id;
+        }
+    }
+    int removed = l->count - kept;
+    l->count = kept;
+    return removed;
+}
+
+/* Pack the out- or in-lists of all nodes, freeing the lists. */
+static packing pack(graph *g, bool in)
+{
+    packing p = {0};
+    size_t capacity = 64;
+    size_t used = 0;
+    unsigned char *bytes = check(alloc_malloc(ALLOC_GRAPH, capacity));
+    p.at = check(alloc_malloc(ALLOC_GRAPH, (g->freeIndex + 1) * sizeof(*p.at)));
+    for (int i = 0; i < g->freeIndex; i++) {
+        node *n = array_1d_inspect_value(g->cities, i);
+        idlist *l = in ? &n->in : &n->out;
+        if (l->count > 1) {
+            qsort(l->ids, l->count, sizeof(graph_id), compare_id);
+        }
+
+        // Each varint takes at most 10 bytes
+        while (used + 10 * (size_t)l->count > capacity) {
+            capacity *= 2;
+            bytes = check(alloc_realloc(ALLOC_GRAPH, bytes, capacity));
+        }
+        p.at[i] = used;
+        graph_id last = (graph_id)i;
+        for (int k = 0; k < l->count; k++) {
+            uint64_t v = (uint64_t)(l->ids[k] - last);
+            if (k == 0) {
+                // Zig-zag, so that a small step down is a small number
+                int64_t delta = (int64_t)l->ids[k] - (int64_t)last;
+                v = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+            }
+            used += put_varint(bytes + used, v);
+            last = l->ids[k];
+        }
+        // Free the list right away, so the peak stays near the old size
+        alloc_free(l->ids);
+        l->ids = NULL;
+        l->room = 0;
+    }
+    p.at[g->freeIndex] = used;
+    // Give back the slack, the graph will not grow again
+    p.bytes = check(alloc_realloc(ALLOC_GRAPH, bytes, used > 0 ? used : 1));
+    return p;
+}
+
+/* Forget the component labels, which no longer hold. */
+static void drop_components(graph *g)
+{
+    alloc_free(g->componentSize);
+    g->componentSize = NULL;
+    g->numComponents = 0;
+}
+
+/* Store the lists of all nodes in one direction as a bit matrix. */
+static array_2d *to_matrix(graph *g, bool in)
+{
+    int words = (g->freeIndex + WORD_BITS - 1) / WORD_BITS;
+    array_2d *m = check(array_2d_create(0, g->freeIndex - 1, 0, words - 1, NULL));
+    for (int i = 0; i < g->freeIndex; i++) {
+        node *n = array_1d_inspect_value(g->cities, i);
+        idlist *l = in ? &n->in : &n->out;
+        for (int k = 0; k < l->count; k++) {
+            int w = l->ids[k] / WORD_BITS;
+            uintptr_t bits = (uintptr_t)array_2d_inspect_value(m, i, w);
+            bits |= (uintptr_t)1 << (l->ids[k] % WORD_BITS);
+            array_2d_set_value(m, (void *)bits, i, w);
+        }
+        alloc_free(l->ids);
+        l->ids = NULL;
+        l->room = 0;
+    }
+    return m;
+}
+
+/* Load the current word of a matrix row, leaving out the seen bits. */
+static void load_word(neighbour_iter *it)
+{
+    it->bits = (uintptr_t)array_2d_inspect_value(it->rows, it->row, it->word);
+    if (it->seen != NULL) {
+        // The seen bits of the word, which lies within one set word
+        size_t first = (size_t)it->word * WORD_BITS;
+        uint64_t *w = &it->seen->words[first / 64];
+        it->scanned += __builtin_popcountll(it->bits);
+        it->bits &= ~(uintptr_t)(*w >> (first % 64));
+        *w |= (uint64_t)it->bits << (first % 64);
+    }
+}
+
+/* Step it to the next neighbour in a list or packed list. */
+static bool step(neighbour_iter *it, graph_id *id)
+{
+    if (!it->packed) {
+        if (it->ids == it->idsEnd) {
+            return false;
+        }
+        *id = *it->ids++;
+        return true;
+    }
+    if (it->next == it->end) {
+        return false;
+    }
+    uint64_t v = get_varint(&it->next);
+    if (it->first) {
+        // The first neighbour is stored relative to the node itself,
+        // zig-zag coded since it can lie on either side
+        it->last += (graph_id)((v >> 1) ^ -(v & 1));
+        it->first = false;
+    } else {
+        it->last += (graph_id)v;
+    }
+    *id = it->last;
+    return true;
+}
+
+/* Set up it to go through l, or the packed list of node index. */
+static void begin(const packing *p, const idlist *l, int index, bitset *seen,
+                  neighbour_iter *it)
+{
+    it->seen = seen;
+    it->scanned = 0;
+    it->matrix = p->bits != NULL;
+    if (it->matrix) {
+        it->packed = false;
+        it->rows = p->bits;
+        it->row = index;
+        it->word = 0;
+        it->words = array_2d_high(p->bits, 2) + 1;
+        load_word(it);
+        return;
+    }
+    it->packed = p->bytes != NULL;
+    if (it->packed) {
+        it->next = p->bytes + p->at[index];
+        it->end = p->bytes + p->at[index + 1];
+        it->last = (graph_id)index;
+        it->first = true;
+    } else {
+        it->ids = l->ids;
+        it->idsEnd = l->ids + l->count;
+    }
+}
+
 // =================== GRAPH STRUCTURE INTERFACE ======================
 
 /**
  * graph_empty() - Create an empty graph.
- * @max_nodes: The maximum number of nodes the graph can hold.
+ * @max_nodes: The number of nodes to make room for. The graph grows
+ *             when more nodes are inserted.
  *
  * Returns: A pointer to the new graph.
  */
 graph *graph_empty(int max_nodes){
-    graph *g = calloc(1, sizeof(struct graph));
+    graph *g = alloc_calloc(ALLOC_GRAPH, 1, sizeof(struct graph));
     g->cities = array_1d_create(0, max_nodes, NULL);
     g->freeIndex = 0;
-    g->size = max_nodes;
+    g->capacity = max_nodes + 1;
     return g;
 }
 
@@ -55,10 +284,28 @@ bool graph_is_empty(const graph *g){
  * Returns: True if graph has any edges, otherwise false.
  */
 bool graph_has_edges(const graph *g){
-    for (int i = 0; i < g->size; i++)
+    if (g->out.bits != NULL)
+    {
+        for (int i = 0; i < g->freeIndex; i++)
+        {
+            neighbour_iter it;
+            graph_id id;
+            begin(&g->out, NULL, i, NULL, &it);
+            if (graph_neighbours_next(g, &it, &id))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (g->out.bytes != NULL)
+    {
+        return g->out.at[g->freeIndex] > 0;
+    }
+    for (int i = 0; i < g->freeIndex; i++)
     {
         node *inspected = array_1d_inspect_value(g->cities, i);
-        if (!dlist_is_empty(inspected->neighbours))
+        if (inspected->out.count > 0)
         {
             return true;
         }
@@ -72,14 +319,34 @@ bool graph_has_edges(const graph *g){
  * @s: Node name.
  *
  * Creates a new node with a copy of the given name and puts it into
- * the graph.
+ * the graph. Exits with an error message if there are no node IDs left.
  *
  * Returns: The modified graph.
  */
 graph *graph_insert_node(graph *g, const char *s){
-    node *n = calloc(1, sizeof(node));
+    if ((uint64_t)g->freeIndex > (graph_id)-1)
+    {
+        fprintf(stderr, "ERROR: Too many cities for %d-bit node IDs!\n", GRAPH_ID_BITS);
+        exit(EXIT_FAILURE);
+    }
+    if (g->freeIndex == g->capacity)
+    {
+        // Double the room, which keeps insertion amortized O(1)
+        array_1d *bigger = array_1d_create(0, 2 * g->capacity - 1, NULL);
+        for (int i = 0; i < g->freeIndex; i++)
+        {
+            array_1d_set_value(bigger, array_1d_inspect_value(g->cities, i), i);
+        }
+        array_1d_kill(g->cities);
+        g->cities = bigger;
+        g->capacity *= 2;
+    }
+    if (g->numComponents > 0)
+    {
+        drop_components(g);
+    }
+    node *n = alloc_calloc(ALLOC_GRAPH, 1, sizeof(node));
     n->name = s;
-    n->neighbours = dlist_empty(NULL);
     n->index = g->freeIndex;
     array_1d_set_value(g->cities, n, g->freeIndex);
     g->freeIndex++;
@@ -94,7 +361,7 @@ graph *graph_insert_node(graph *g, const char *s){
  * Returns: A pointer to the found node, or NULL.
  */
 node *graph_find_node(const graph *g, const char *s){
-    for (int i = 0; i < g->size; i++)
+    for (int i = 0; i < g->freeIndex; i++)
     {
         node *inspected = array_1d_inspect_value(g->cities, i);
         if (!strcmp(inspected->name,s))
@@ -105,6 +372,68 @@ node *graph_find_node(const graph *g, const char *s){
     return NULL;
 }
 
+/**
+ * graph_get_node() - Return the node stored at a given index.
+ * @g: Graph to inspect.
+ * @index: Index of the node, 0 for the first inserted node.
+ *
+ * NOTE: Undefined unless index is below the number of inserted nodes.
+ *
+ * Returns: A pointer to the node.
+ */
+node *graph_get_node(const graph *g, int index){
+    return array_1d_inspect_value(g->cities, index);
+}
+
+/**
+ * graph_node_count() - Return the number of inserted nodes.
+ * @g: Graph to inspect.
+ *
+ * Returns: The number of nodes inserted so far.
+ */
+int graph_node_count(const graph *g){
+    return g->freeIndex;
+}
+
+/**
+ * graph_node_index() - Return the index of a node.
+ * @g: Graph storing the node.
+ * @n: Node in the graph.
+ *
+ * The index is the insertion order of the node, and is what
+ * graph_get_node() takes.
+ *
+ * Returns: The index of the node.
+ */
+int graph_node_index(const graph *g, const node *n){
+    return n->index;
+}
+
+/**
+ * graph_node_id() - Return the ID of a node.
+ * @g: Graph storing the node.
+ * @n: Node in the graph.
+ *
+ * The ID has the same value as the index, in the GRAPH_ID_BITS wide
+ * type that the neighbour lists are stored with.
+ *
+ * Returns: The ID of the node.
+ */
+graph_id graph_node_id(const graph *g, const node *n){
+    return (graph_id)n->index;
+}
+
+/**
+ * graph_node_name() - Return the name of a node.
+ * @g: Graph storing the node.
+ * @n: Node in the graph.
+ *
+ * Returns: The name the node was inserted with.
+ */
+const char *graph_node_name(const graph *g, const node *n){
+    return n->name;
+}
+
 /**
  * graph_node_is_seen() - Return the seen status for a node.
  * @g: Graph storing the node.
@@ -136,7 +465,7 @@ graph *graph_node_set_seen(graph *g, node *n, bool seen){
  * Returns: The modified graph.
  */
 graph *graph_reset_seen(graph *g){
-    for (int i = 0; i < g->size; i++)
+    for (int i = 0; i < g->freeIndex; i++)
     {
         node *inspected = array_1d_inspect_value(g->cities, i);
         inspected->seen = false;
@@ -150,13 +479,21 @@ graph *graph_reset_seen(graph *g){
  * @n1: Source node (pointer) for the edge.
  * @n2: Destination node (pointer) for the edge.
  *
- * NOTE: Undefined unless both nodes are already in the graph.
+ * NOTE: Undefined unless both nodes are already in the graph. Also
+ * undefined after graph_compact() or graph_choose_matrix().
  *
  * Returns: The modified graph.
  */
 graph *graph_insert_edge(graph *g, node *n1, node *n2){
-    
-    dlist_insert(n1->neighbours, n2, dlist_first(n1->neighbours));
+    if (g->numComponents > 0 && n1->component != n2->component)
+    {
+        drop_components(g);
+    }
+    append_id(&n1->out, (graph_id)n2->index);
+    if (g->hasIn)
+    {
+        append_id(&n2->in, (graph_id)n1->index);
+    }
     return g;
 }
 
@@ -170,17 +507,396 @@ graph *graph_insert_edge(graph *g, node *n1, node *n2){
  */
 dlist *graph_neighbours(const graph *g,const node *n){
     dlist *temp = dlist_empty(NULL);
-    node *inspected = array_1d_inspect_value(g->cities, n->index);
-    dlist_pos pos = dlist_first(inspected->neighbours);
-
-    while (!dlist_is_end(inspected->neighbours, pos)){
-        char *neighbour = dlist_inspect(inspected->neighbours, pos);
-        dlist_insert(temp, neighbour, dlist_first(temp));
-        pos = dlist_next(inspected->neighbours, pos);
+    neighbour_iter it;
+    graph_id id;
+    graph_neighbours_begin(g, n, &it);
+    while (graph_neighbours_next(g, &it, &id)){
+        dlist_insert(temp, graph_get_node(g, id), dlist_first(temp));
     }
     return temp;
 }
 
+/**
+ * graph_remove_duplicates() - Remove repeated edges and self-loops.
+ * @g: Graph to modify. Must not be compact or a matrix.
+ *
+ * Neither kind of edge changes which nodes can be reached, but both
+ * are followed on every search. Each neighbour list is left sorted.
+ *
+ * Returns: The number of edges removed.
+ */
+int graph_remove_duplicates(graph *g){
+    int removed = 0;
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        node *n = array_1d_inspect_value(g->cities, i);
+        removed += drop_duplicates(&n->out, (graph_id)n->index);
+        drop_duplicates(&n->in, (graph_id)n->index);
+    }
+    return removed;
+}
+
+/**
+ * graph_renumber() - Give every node a new index.
+ * @g: Graph to renumber. Must not be compact or a matrix.
+ * @newIndex: newIndex[i] is the new index of the node now at index i.
+ *             Must be a permutation of 0 to the node count minus one.
+ *
+ * Neighbour lists are rewritten to the new indices. Names and nodes
+ * stay the same, so graph_find_node() finds the same node as before.
+ *
+ * Returns: The modified graph.
+ */
+graph *graph_renumber(graph *g, const int *newIndex){
+    array_1d *moved = array_1d_create(0, g->capacity - 1, NULL);
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        node *n = array_1d_inspect_value(g->cities, i);
+        n->index = newIndex[i];
+        for (int k = 0; k < n->out.count; k++)
+        {
+            n->out.ids[k] = (graph_id)newIndex[n->out.ids[k]];
+        }
+        for (int k = 0; k < n->in.count; k++)
+        {
+            n->in.ids[k] = (graph_id)newIndex[n->in.ids[k]];
+        }
+        array_1d_set_value(moved, n, n->index);
+    }
+    array_1d_kill(g->cities);
+    g->cities = moved;
+    return g;
+}
+
+/**
+ * graph_neighbours_begin() - Start going through the neighbours of a node.
+ * @g: Graph to inspect.
+ * @n: Node to get neighbours for.
+ * @it: Iterator to set up.
+ *
+ * Unlike graph_neighbours() nothing is allocated. The neighbours are
+ * returned by graph_neighbours_next(), in ascending ID order if the
+ * graph is compact. The graph must not be modified meanwhile.
+ *
+ * Returns: Nothing.
+ */
+void graph_neighbours_begin(const graph *g, const node *n, neighbour_iter *it){
+    begin(&g->out, &n->out, n->index, NULL, it);
+}
+
+/**
+ * graph_neighbours_next() - Return the next neighbour of a node.
+ * @g: Graph to inspect.
+ * @it: Iterator set up by graph_neighbours_begin().
+ * @id: Set to the ID of the neighbour.
+ *
+ * Returns: True if there was another neighbour, false when done.
+ */
+bool graph_neighbours_next(const graph *g, neighbour_iter *it, graph_id *id){
+    if (it->matrix)
+    {
+        while (it->bits == 0)
+        {
+            if (++it->word == it->words)
+            {
+                return false;
+            }
+            load_word(it);
+        }
+        // Take the lowest bit set, then clear it
+        *id = (graph_id)(it->word * WORD_BITS + __builtin_ctzll(it->bits));
+        it->bits &= it->bits - 1;
+        return true;
+    }
+    while (step(it, id))
+    {
+        if (it->seen == NULL)
+        {
+            return true;
+        }
+        it->scanned++;
+        if (!bitset_test_and_set(it->seen, *id))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * graph_unseen_neighbours_begin() - Start going through the neighbours
+ *                                   of a node that are not yet seen.
+ * @g: Graph to inspect.
+ * @n: Node to get neighbours for.
+ * @seen: Visited set, sized to the graph.
+ * @it: Iterator to set up.
+ *
+ * Works like graph_neighbours_begin(), but graph_neighbours_next() skips
+ * the neighbours in seen and adds each neighbour it returns. A matrix
+ * graph skips the seen neighbours a word at a time.
+ *
+ * Returns: Nothing.
+ */
+void graph_unseen_neighbours_begin(const graph *g, const node *n, bitset *seen,
+                                   neighbour_iter *it){
+    begin(&g->out, &n->out, n->index, seen, it);
+}
+
+/**
+ * graph_neighbours_scanned() - Return how many neighbours were looked at.
+ * @it: Iterator set up by graph_unseen_neighbours_begin().
+ *
+ * Returns: The number of neighbours passed so far, seen or not.
+ */
+unsigned long graph_neighbours_scanned(const neighbour_iter *it){
+    return it->scanned;
+}
+
+/**
+ * graph_keep_in_edges() - Keep the in-edges of every node from now on.
+ * @g: Graph to modify. Must not be compact or a matrix.
+ *
+ * The in-edges of the edges already inserted are collected at once,
+ * later ones as they are inserted. Each in-edge takes as much memory
+ * as an out-edge.
+ *
+ * Returns: The modified graph.
+ */
+graph *graph_keep_in_edges(graph *g){
+    if (g->hasIn)
+    {
+        return g;
+    }
+    g->hasIn = true;
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        node *n = array_1d_inspect_value(g->cities, i);
+        for (int k = 0; k < n->out.count; k++)
+        {
+            node *to = array_1d_inspect_value(g->cities, n->out.ids[k]);
+            append_id(&to->in, (graph_id)i);
+        }
+    }
+    return g;
+}
+
+/**
+ * graph_has_in_edges() - Check if a graph keeps in-edges.
+ * @g: Graph to check.
+ *
+ * Returns: True after graph_keep_in_edges(), otherwise false.
+ */
+bool graph_has_in_edges(const graph *g){
+    return g->hasIn;
+}
+
+/**
+ * graph_in_neighbours_begin() - Start going through the nodes with an
+ *                               edge to a node.
+ * @g: Graph to inspect. Must keep in-edges.
+ * @n: Node to get in-neighbours for.
+ * @it: Iterator to set up.
+ *
+ * Works like graph_neighbours_begin(), the nodes are returned by
+ * graph_neighbours_next().
+ *
+ * Returns: Nothing.
+ */
+void graph_in_neighbours_begin(const graph *g, const node *n, neighbour_iter *it){
+    begin(&g->in, &n->in, n->index, NULL, it);
+}
+
+/**
+ * graph_compact() - Pack all neighbour lists into a read-only format.
+ * @g: Graph to pack.
+ *
+ * Each neighbour list is sorted and stored as varints in one shared
+ * byte array: the first neighbour relative to the node, each further
+ * one as the gap from the previous. Usually one or two bytes per edge
+ * instead of a full ID. Nodes and edges must not be inserted
+ * afterwards, everything else works as before.
+ *
+ * Returns: The modified graph.
+ */
+graph *graph_compact(graph *g){
+    if (g->out.bytes != NULL || g->out.bits != NULL)
+    {
+        return g;
+    }
+    g->out = pack(g, false);
+    if (g->hasIn)
+    {
+        g->in = pack(g, true);
+    }
+    return g;
+}
+
+/**
+ * graph_choose_matrix() - Keep the edges in a bit matrix if it pays off.
+ * @g: Graph to convert. Must not be compact.
+ *
+ * If there are at least GRAPH_MATRIX_DENSITY edges per pair of nodes,
+ * the neighbour lists are replaced by an array_2d with one bit per pair
+ * of nodes, packed into pointer sized words. The neighbours of a node
+ * are then read a word at a time, in ascending ID order. Nodes and
+ * edges must not be inserted afterwards, everything else works as
+ * before.
+ *
+ * Returns: True if the graph was converted, otherwise false.
+ */
+bool graph_choose_matrix(graph *g){
+    if (g->out.bytes != NULL || g->out.bits != NULL || g->freeIndex == 0)
+    {
+        return false;
+    }
+    size_t edges = 0;
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        node *n = array_1d_inspect_value(g->cities, i);
+        edges += n->out.count;
+    }
+    if (edges < GRAPH_MATRIX_DENSITY * g->freeIndex * g->freeIndex)
+    {
+        return false;
+    }
+    g->out.bits = to_matrix(g, false);
+    if (g->hasIn)
+    {
+        g->in.bits = to_matrix(g, true);
+    }
+    return true;
+}
+
+/**
+ * graph_is_matrix() - Check if graph_choose_matrix() has converted a graph.
+ * @g: Graph to check.
+ *
+ * Returns: True if the edges are kept in a bit matrix, otherwise false.
+ */
+bool graph_is_matrix(const graph *g){
+    return g->out.bits != NULL;
+}
+
+/**
+ * graph_is_compact() - Check if graph_compact() has packed a graph.
+ * @g: Graph to check.
+ *
+ * Returns: True if the graph is compact, otherwise false.
+ */
+bool graph_is_compact(const graph *g){
+    return g->out.bytes != NULL;
+}
+
+/**
+ * graph_edge_bytes() - Return the bytes holding the packed neighbours.
+ * @g: Compact or matrix graph to inspect.
+ *
+ * Returns: The size of the packed neighbour lists or of the matrix,
+ * in-edges included, not counting the offset of each node.
+ */
+size_t graph_edge_bytes(const graph *g){
+    size_t bytes = 0;
+    if (g->out.bits != NULL)
+    {
+        size_t words = (size_t)g->freeIndex * (array_2d_high(g->out.bits, 2) + 1);
+        bytes += (g->in.bits != NULL ? 2 : 1) * words * sizeof(uintptr_t);
+    }
+    if (g->out.bytes != NULL)
+    {
+        bytes += g->out.at[g->freeIndex];
+    }
+    if (g->in.bytes != NULL)
+    {
+        bytes += g->in.at[g->freeIndex];
+    }
+    return bytes;
+}
+
+/**
+ * graph_label_components() - Label the weakly connected components.
+ * @g: Graph to label.
+ *
+ * Every edge is taken to run both ways and the nodes are joined with a
+ * union-find, so a node can only reach nodes with the same label. The
+ * labels are numbered from 0 in the order of the first node of each
+ * component. They are dropped when a node is inserted, or an edge
+ * between two components, until the graph is labelled again.
+ *
+ * Returns: The number of components.
+ */
+int graph_label_components(graph *g){
+    drop_components(g);
+    unionfind *uf = unionfind_empty(g->freeIndex);
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        node *n = array_1d_inspect_value(g->cities, i);
+        neighbour_iter it;
+        graph_id id;
+        graph_neighbours_begin(g, n, &it);
+        while (graph_neighbours_next(g, &it, &id))
+        {
+            unionfind_union(uf, n->index, id);
+        }
+    }
+    // Number the components by their first node, through their roots
+    int *label = check(alloc_malloc(ALLOC_GRAPH, (g->freeIndex + 1) * sizeof(int)));
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        label[i] = -1;
+    }
+    g->componentSize = check(alloc_calloc(ALLOC_GRAPH, unionfind_set_count(uf) + 1, sizeof(int)));
+    for (int i = 0; i < g->freeIndex; i++)
+    {
+        int root = unionfind_find(uf, i);
+        if (label[root] < 0)
+        {
+            label[root] = g->numComponents++;
+        }
+        node *n = array_1d_inspect_value(g->cities, i);
+        n->component = label[root];
+        g->componentSize[n->component]++;
+    }
+    alloc_free(label);
+    unionfind_kill(uf);
+    return g->numComponents;
+}
+
+/**
+ * graph_component_count() - Return the number of labelled components.
+ * @g: Graph to inspect.
+ *
+ * Returns: The number of components, or 0 if the graph is not labelled.
+ */
+int graph_component_count(const graph *g){
+    return g->numComponents;
+}
+
+/**
+ * graph_component_size() - Return the number of nodes in a component.
+ * @g: Labelled graph to inspect.
+ * @label: Label of the component.
+ *
+ * Returns: The number of nodes with the label.
+ */
+int graph_component_size(const graph *g, int label){
+    return g->componentSize[label];
+}
+
+/**
+ * graph_may_reach() - Check if a path between two nodes is possible.
+ * @g: Graph storing the nodes.
+ * @n1: Origin node.
+ * @n2: Destination node.
+ *
+ * Answers in constant time, without a search.
+ *
+ * Returns: False if the graph is labelled and the nodes are in different
+ * components, otherwise true.
+ */
+bool graph_may_reach(const graph *g, const node *n1, const node *n2){
+    return g->numComponents == 0 || n1->component == n2->component;
+}
+
 /**
  * graph_kill() - Destroy a given graph.
  * @g: Graph to destroy.
@@ -190,14 +906,28 @@ dlist *graph_neighbours(const graph *g,const node *n){
  * Returns: Nothing.
  */
 void graph_kill(graph *g){
-    for (int i = 0; i < g->size; i++)
+    for (int i = 0; i < g->freeIndex; i++)
     {
         node *inspected = array_1d_inspect_value(g->cities, i);
-        dlist_kill(inspected->neighbours);
-        free(inspected);
+        alloc_free(inspected->out.ids);
+        alloc_free(inspected->in.ids);
+        alloc_free(inspected);
+    }
+    alloc_free(g->out.bytes);
+    alloc_free(g->out.at);
+    alloc_free(g->in.bytes);
+    alloc_free(g->in.at);
+    if (g->out.bits != NULL)
+    {
+        array_2d_kill(g->out.bits);
+    }
+    if (g->in.bits != NULL)
+    {
+        array_2d_kill(g->in.bits);
     }
+    alloc_free(g->componentSize);
     array_1d_kill(g->cities);
-    free(g);
+    alloc_free(g);
 }
 
 /**
@@ -209,7 +939,7 @@ void graph_kill(graph *g){
  * Returns: Nothing.
  */
 void graph_print(const graph *g){
-    for (int i = 0; i < g->size; i++)
+    for (int i = 0; i < g->freeIndex; i++)
     {
         node *inspected_node = array_1d_inspect_value(g->cities, i);
         printf("Node %d: %s\n", inspected_node->index, inspected_node->name);
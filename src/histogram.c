@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "alloc.h"
+#include "histogram.h"
+
+/*
+ * Implementation of the log-bucketed latency histogram.
+ *
+ * Values below HISTOGRAM_SUB_COUNT get one bucket each. A larger value
+ * with its highest set bit at position e lands in row e-SUB_BITS+1, in
+ * the sub-bucket given by the SUB_BITS bits just below the highest bit.
+ */
+
+#define DUMP_HEADER "# latency-histogram v1 unit=ns sub_bits=%d\n"
+
+/* Return the bucket index for a value. */
+static int bucket_index(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_COUNT) {
+        return (int)value;
+    }
+    int highest = 63 - __builtin_clzll(value);
+    int shift = highest - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_COUNT
+        + (int)((value >> shift) - HISTOGRAM_SUB_COUNT);
+}
+
+/* Return the highest value that maps to the given bucket. */
+static uint64_t bucket_highest(int index)
+{
+    if (index < HISTOGRAM_SUB_COUNT) {
+        return index;
+    }
+    int shift = index / HISTOGRAM_SUB_COUNT - 1;
+    uint64_t low = (uint64_t)(HISTOGRAM_SUB_COUNT + index % HISTOGRAM_SUB_COUNT) << shift;
+    return low + (((uint64_t)1 << shift) - 1);
+}
+
+/**
+ * histogram_empty() - Create an empty histogram.
+ *
+ * Returns: A pointer to the new histogram. Must be alloc_free()-d after use.
+ */
+histogram *histogram_empty(void){
+    histogram *h = alloc_calloc(ALLOC_STATS, 1, sizeof(*h));
+    if (h == NULL)
+    {
+        printf("Unable to allocate memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    h->min = UINT64_MAX;
+    return h;
+}
+
+/**
+ * histogram_record() - Record one value.
+ * @h: Histogram to update.
+ * @value: Value to record, in nanoseconds.
+ *
+ * Returns: Nothing.
+ */
+void histogram_record(histogram *h, uint64_t value){
+    h->counts[bucket_index(value)]++;
+    h->total++;
+    if (value < h->min)
+    {
+        h->min = value;
+    }
+    if (value > h->max)
+    {
+        h->max = value;
+    }
+}
+
+/**
+ * histogram_percentile() - Return the value at a given percentile.
+ * @h: Histogram to inspect.
+ * @p: Percentile, 0 to 100.
+ *
+ * Returns: The highest value equivalent to the bucket holding the
+ * percentile, capped at the recorded maximum, or 0 if h is empty.
+ */
+uint64_t histogram_percentile(const histogram *h, double p){
+    if (h->total == 0)
+    {
+        return 0;
+    }
+    // Rank of the wanted value counting from 1, rounded up
+    double exact = p / 100.0 * h->total;
+    uint64_t rank = (uint64_t)exact;
+    if (rank < exact)
+    {
+        rank++;
+    }
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen >= rank)
+        {
+            uint64_t v = bucket_highest(i);
+            return v < h->max ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+/**
+ * histogram_merge() - Add all counts of one histogram to another.
+ * @h: Histogram to update.
+ * @other: Histogram to add.
+ *
+ * Returns: Nothing.
+ */
+void histogram_merge(histogram *h, const histogram *other){
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        h->counts[i] += other->counts[i];
+    }
+    h->total += other->total;
+    if (other->min < h->min)
+    {
+        h->min = other->min;
+    }
+    if (other->max > h->max)
+    {
+        h->max = other->max;
+    }
+}
+
+/**
+ * histogram_report() - Print count, p50, p90, p99, p99.9 and max.
+ * @out: Stream to print to.
+ * @label: Text printed in front of the report.
+ * @h: Histogram to report.
+ *
+ * Returns: Nothing.
+ */
+void histogram_report(FILE *out, const char *label, const histogram *h){
+    fprintf(out, "%s: count=%" PRIu64 " p50=%.3fus p90=%.3fus p99=%.3fus "
+            "p99.9=%.3fus max=%.3fus\n", label, h->total,
+            histogram_percentile(h, 50.0) / 1e3,
+            histogram_percentile(h, 90.0) / 1e3,
+            histogram_percentile(h, 99.0) / 1e3,
+            histogram_percentile(h, 99.9) / 1e3,
+            h->max / 1e3);
+}
+
+/**
+ * histogram_write() - Write a histogram dump.
+ * @out: Stream to write to.
+ * @h: Histogram to dump.
+ *
+ * Only non-empty buckets are written, one "index count" pair per line.
+ *
+ * Returns: Nothing.
+ */
+void histogram_write(FILE *out, const histogram *h){
+    fprintf(out, DUMP_HEADER, HISTOGRAM_SUB_BITS);
+    fprintf(out, "total %" PRIu64 "\n", h->total);
+    fprintf(out, "min %" PRIu64 "\n", h->total ? h->min : 0);
+    fprintf(out, "max %" PRIu64 "\n", h->max);
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        if (h->counts[i])
+        {
+            fprintf(out, "%d %" PRIu64 "\n", i, h->counts[i]);
+        }
+    }
+}
+
+/**
+ * histogram_read() - Read a histogram dump and merge it into h.
+ * @in: Stream to read from.
+ * @h: Histogram to update.
+ *
+ * Returns: True if the dump was read, false if it was malformed.
+ */
+bool histogram_read(FILE *in, histogram *h){
+    histogram *d = histogram_empty();
+    int subBits;
+    uint64_t total, min, max, count;
+    int index;
+    bool ok = false;
+
+    if (fscanf(in, "# latency-histogram v1 unit=ns sub_bits=%d", &subBits) == 1
+        && subBits == HISTOGRAM_SUB_BITS
+        && fscanf(in, " total %" SCNu64 " min %" SCNu64 " max %" SCNu64,
+                  &total, &min, &max) == 3)
+    {
+        ok = true;
+        while (fscanf(in, "%d %" SCNu64, &index, &count) == 2)
+        {
+            if (index < 0 || index >= HISTOGRAM_BUCKETS)
+            {
+                ok = false;
+                break;
+            }
+            d->counts[index] += count;
+            d->total += count;
+        }
+        // The bucket counts must add up to the stated total
+        if (ok && !feof(in))
+        {
+            ok = false;
+        }
+        if (ok && d->total != total)
+        {
+            ok = false;
+        }
+        d->min = total ? min : UINT64_MAX;
+        d->max = max;
+    }
+    if (ok)
+    {
+        histogram_merge(h, d);
+    }
+    alloc_free(d);
+    return ok;
+}
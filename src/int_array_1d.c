@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "alloc.h"
+#include "int_array_1d.h"
+
+/*
+ * Implementation of an integer 1D array for the "Datastructures and
+ * algorithms" courses at the Department of Computing Science, Umea
+ * University.
+ *
+ * Authors: Niclas Borlin (niclas@cs.umu.se)
+ *
+ * Based on earlier code by: Johan Eliasson (johane@cs.umu.se).
+ *
+ * Version information:
+ *   2018-01-28: v1.0, first public version.
+ */
+
+// ===========INTERNAL DATA TYPES============
+
+struct int_array_1d {
+	int low; // Low index limit.
+	int high; // High index limit.
+	int array_size; // Number of array elements.
+	int *values; // Pointer to where the actual values are stored.
+};
+
+// ===========INTERNAL FUNCTION IMPLEMENTATIONS============
+
+/**
+ * int_array_1d_create() - Create an array without values.
+ * @lo: low index limit.
+ * @hi: high index limit.
+ *
+ * The index limits are inclusive, i.e. all indices i such that low <=
+ * i <= high are defined.
+ * 
+ * Returns: A pointer to the new array, or NULL if not enough memory
+ * was available.
+ */
+int_array_1d *int_array_1d_create(int lo, int hi)
+{
+	// Allocate array structure.
+	int_array_1d *a=alloc_calloc(ALLOC_ARRAY, 1, sizeof(*a));
+	if (a == NULL) {
+		return NULL;
+	}
+	// Store index limit.
+	a->low=lo;
+	a->high=hi;
+
+	// Number of elements.
+	a->array_size = hi-lo+1;
+
+	// At least one element, so that an empty range is not a failure.
+	a->values=alloc_calloc(ALLOC_ARRAY, a->array_size > 0 ? a->array_size : 1,
+			       sizeof(int));
+	
+	// Check whether the allocation succeeded.
+	if (a->values == NULL) {
+		alloc_free(a);
+		a=NULL;
+	}
+	return a;
+}
+
+/**
+ * int_array_1d_low() - Return the low index limit for the array.
+ * @a: array to inspect.
+ *
+ * Returns: The low index limit.
+ */
+int int_array_1d_low(const int_array_1d *a)
+{
+	return a->low;
+}
+
+/**
+ * int_array_1d_high() - Return the high index limit for the array.
+ * @a: array to inspect.
+ *
+ * Returns: The high index limit.
+ */
+int int_array_1d_high(const int_array_1d *a)
+{
+	return a->high;
+}
+
+/**
+ * int_array_1d_inspect_value() - Inspect a value at a given array position.
+ * @a: array to inspect.
+ * @i: index of position to inspect.
+ *
+ * Returns: The element value at the specified position, or 0 if no
+ *	    value is stored at that position.
+ */
+int int_array_1d_inspect_value(const int_array_1d *a, int i)
+{
+	int offset=i-int_array_1d_low(a);
+	// Return the value.
+	return a->values[offset];
+}
+
+/**
+ * int_array_1d_has_value() - Check if a value is set at a given array position.
+ * @a: array to inspect.
+ * @i: index of position to inspect.
+ *
+ * Returns: True if a value is set at the specified position, otherwise false.
+ */
+bool int_array_1d_has_value(const int_array_1d *a, int i)
+{
+	int offset=i-int_array_1d_low(a);
+	// Return true if the value is not 0.
+	return a->values[offset] != 0;
+}
+
+/**
+ * int_array_1d_set_value() - Set a value at a given array position.
+ * @a: array to modify.
+ * @v: value to set element to, or 0 to clear value.
+ * @i: index of position to modify.
+ * 
+ * Returns: Nothing.
+ */
+void int_array_1d_set_value(int_array_1d *a, int v, int i)
+{
+	int offset=i-int_array_1d_low(a);
+	// Set value.
+	a->values[offset]=v;
+}
+
+/**
+ * int_array_1d_kill() - Return memory allocated by array.
+ * @a: array to kill.
+ * 
+ * Returns: Nothing.
+ */
+void int_array_1d_kill(int_array_1d *a)
+{
+	// Free actual storage.
+	alloc_free(a->values);
+	// Free array structure.
+	alloc_free(a);
+}
+
+/**
+ * int_array_1d_print() - Iterate over the array element and print their values.
+ * @a: Array to inspect.
+ *
+ * Iterates over each position in the array. Prints each non-zero element.
+ *
+ * Returns: Nothing.
+ */
+void int_array_1d_print(const int_array_1d *a)
+{
+	printf("[ ");
+	for (int i=int_array_1d_low(a); i<=int_array_1d_high(a); i++) {
+		if (int_array_1d_has_value(a,i)) {
+			printf("[%d]", int_array_1d_inspect_value(a,i));
+		} else {
+			printf(" []");
+		}
+		if (i<int_array_1d_high(a)) {
+			printf(", ");
+		}
+	}
+	printf(" ]\n");
+}
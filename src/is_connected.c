@@ -1,14 +1,42 @@
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <ctype.h>
+#include <inttypes.h>
+#include <sys/stat.h>
 
+#include "alloc.h"
 #include "list.h"
 #include "graph.h"
-#include "queue.h"
-#define BUFSIZE 300
+#include "int_array_1d.h"
+#include "bitset.h"
+#include "stats.h"
+#include "histogram.h"
+#include "trace.h"
+#include "qlog.h"
+#include "loader.h"
+#include "source.h"
+#include "shmgraph.h"
+#include "extgraph.h"
+#include "unionfind.h"
+#include "cluster.h"
+#include "search.h"
+#include "pipeline.h"
+#include "server.h"
+#include "strtab.h"
+#include "follow.h"
+#include "reorder.h"
+// Number of queries between two allocation reports.
+#define ALLOC_BATCH 1000
+
+// Number of component sizes listed in the load stats.
+#define COMPONENTS_LISTED 5
+
+// Default memory budget of the external memory mode, in bytes.
+#define EXTERNAL_MEMORY (64UL << 20)
 
 /*
  * Program that reads a file representing a map and creates a directed graph
@@ -23,95 +51,6 @@
  *   2020-03-22: v1.0, first public version.
  */
 
-/* Return position of first non-whitespace character or -1 if only
-   white-space is found. */
-int first_non_white_space(const char *s)
-{
-    int i = 0; // Start at first char.
-    // Advance until we hit EOL as long as we're loooking at white-space.
-    while (s[i] && isspace(s[i])) {
-        i++;
-    }
-    if (s[i]) {
-        return i; // Return position of found a non-white-space char.
-    } else {
-        return -1; // Return fail.
-    }
-}
-/**
- * first_white_space() - Reads a string and checks for the first white-space.
- * @s: A string to be searched.
- *
- * Gets a string and returns the position of the first white-space in the string.
- * If no white-space is found, -1 is returned.
- *
- * Returns: The position of the white-space in the string.
- */
-int first_white_space(const char *s){
-    int i = 0;
-
-    while (s[i] && !isspace(s[i]))
-    {
-        i++;
-    }
-    if (s[i])
-    {
-        return i;
-    } else
-    {
-        return -1;
-    }
-}
-
-/* Return position of last non-whitespace character or -1 if only
-   white-space is found. */
-int last_non_white_space(const char *s)
-{
-    // Start at last char.
-    int i = strlen(s) - 1;
-    // Move back until we hit beginning-of-line as long as we're
-    // loooking at white-space.
-    while (i >= 0 && isspace(s[i])) {
-        i--;
-    }
-    if (i >= 0) {
-        return i; // Return position of found a non-white-space char.
-    } else {
-        return -1; // Return fail.
-    }
-}
-
-/* Return true if s only contains whitespace */
-bool line_is_blank(const char *s)
-{
-    // Line is blank if it only contained white-space chars.
-    return first_non_white_space(s) < 0;
-}
-
-/* Return true if s is a comment line, i.e. first non-whitespc char is '#' */
-bool line_is_comment(const char *s)
-{
-    int i = first_non_white_space(s);
-    return (i >= 0 && s[i] == '#');
-}
-
-int has_comment(const char *s){
-    int i = 0; // Start at first char.
-    // Advance until we hit EOL as long as we're loooking at white-space.
-    while (s[i]) {
-        if (s[i] == 35) {
-            return i; // Return position of found a non-white-space char.
-        }
-        i++;
-    }
-    return -1; // Return fail.
-}
-/* Return true if s is a integer line, i.e. '0'..'9' */
-bool line_is_integer(const char *s)
-{
-    char digit = *s;
-    return isdigit(digit);
-}
 /**
  * substring() - Gets only a part of a string.
  * @original: A string to be substringed.
@@ -127,7 +66,7 @@ char *substring(const char *original, int start, int length)
     char *city;
     int position = start, c=0;
     // Allocate memory depending on the length, plus one for '\0'
-    city = malloc(sizeof(char) * length+1);
+    city = alloc_malloc(ALLOC_LOADER, sizeof(char) * length+1);
     // Check if the allocation was successful
     if (city == NULL)
     {
@@ -144,308 +83,451 @@ char *substring(const char *original, int start, int length)
     return city;
 }
 /**
- * read_file() - Reads a file from the hard drive.
- * @in: A FILE reference.
- * @l: A list to insert each row into.
+ * find_path() - Check for a path between two nodes
+ *               using width-first-method.
+ * @n1: First node.
+ * @n2: Second node.
+ * @g: Graph to inspect.
+ * @seen: Visited set, cleared and sized to the graph here.
+ * @stats: Counters for this query, or NULL if not wanted.
  *
- * Ignores empty lines, lines beginning with a '#' and numbers.
+ * Returns a bool if there is a path between n1 & n2. Nodes in different
+ * components of a labelled graph are answered without a search. If
+ * stats is given it is overwritten with the cost of this search.
  *
- * Returns: Nothing but updates the list l.
+ * Returns: True if a path exists between the two nodes.
  */
-void read_file(FILE *in, list *l){
-    char line[BUFSIZE];
-
-    // Read a line at a time from the input file until EOF
-    while (fgets(line, BUFSIZE, in) != NULL) {
-        if (line_is_blank(line) || line_is_comment(line) || line_is_integer(line)) {
-            // Ignore blank lines, comment lines and integer lines.
-            continue;
+bool find_path(node *n1, node *n2, graph *g, bitset *seen, search_stats *stats){
+    search_stats s;
+    stats_reset(&s);
+    s.queries = 1;
+    double start = stats_now();
+    if (!graph_may_reach(g, n1, n2))
+    {
+        s.wall_time = stats_now() - start;
+        if (stats != NULL)
+        {
+            *stats = s;
         }
-        // Check for a '#' in the line
-        int whereToCut = has_comment(line) - 1;
-        // If no '#' was found, use the length of the line instead
-        if (whereToCut <= -1)
+        return false;
+    }
+
+    //Each node is queued at most once, so the IDs fit in a flat array
+    int_array_1d *q = int_array_1d_create(0, graph_node_count(g) - 1);
+    if (q == NULL)
+    {
+        printf("Unable to allocate memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    s.allocations++;
+    int head = 0;
+    int tail = 0;
+    //Mark origin node as seen
+    bitset_clear(seen, graph_node_count(g));
+    bitset_test_and_set(seen, graph_node_id(g, n1));
+    //Add origin node to queue
+    int_array_1d_set_value(q, graph_node_id(g, n1), tail++);
+    s.frontier_peak = 1;
+    while (head < tail)
+    {
+        node *p = graph_get_node(g, int_array_1d_inspect_value(q, head++));
+        s.nodes_visited++;
+        //Inspect the neighbours not seen yet, marking them as seen
+        neighbour_iter it;
+        graph_id id;
+        graph_unseen_neighbours_begin(g, p, seen, &it);
+        while (graph_neighbours_next(g, &it, &id))
         {
-            whereToCut = strlen(line) - 1;
+            //Add current node's neighbours to queue
+            int_array_1d_set_value(q, id, tail++);
+            if ((unsigned long)(tail - head) > s.frontier_peak)
+            {
+                s.frontier_peak = tail - head;
+            }
         }
-        // Substring away excess information
-        char *city = substring(line, 1, whereToCut);
-        list_insert(l, city, list_end(l));
+        s.edges_relaxed += graph_neighbours_scanned(&it);
+    }
+    int_array_1d_kill(q);
+    s.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = s;
+    }
+    //Return true if the destination node was seen
+    if (bitset_test(seen, graph_node_id(g, n2)))
+    {
+        return true;
     }
+    return false;
 }
 
+/*
+ * State shared by all queries against a loaded map.
+ */
+typedef struct session {
+    graph *g;
+    list *cities;
+    int numberOfCities;
+    bool showStats;
+    search_stats total;
+    follower *follow;  // Set in follow mode.
+    strtab *names;     // Node names by index, kept in follow and reverse mode.
+    shmgraph *shm;     // Set when querying a shared graph instead of g.
+    searcher *search;  // Searches the shared graph, or g backwards.
+    extgraph *ext;     // Set in external memory mode instead of g.
+    cluster *cluster;  // Set in sharded mode instead of g.
+    unionfind *uf;     // Set in undirected mode instead of g.
+    bitset *seen;      // Visited set of find_path() on g.
+} session;
+
 /**
- * unique_cities() - Gets the amount of unique cities from a list.
- * @cities: A list of the seperated cities.
- * @edges: A list of unformated cities.
+ * lookup_city() - Find a city when the graph is not held in g.
+ * @sess: The session to query.
+ * @name: Name of the city.
  *
- * Formats the list edges and updates the list cities with this new information.
- * Formating means separating and removing duplicates.
+ * Returns: The index of the city, or -1 if it is not in the map.
+ */
+int lookup_city(const session *sess, const char *name){
+    if (sess->shm != NULL){
+        return shmgraph_lookup(sess->shm, name);
+    }
+    if (sess->ext != NULL){
+        return extgraph_lookup(sess->ext, name);
+    }
+    if (sess->uf != NULL){
+        return unionfind_lookup(sess->uf, name);
+    }
+    return cluster_lookup(sess->cluster, name);
+}
+
+/**
+ * find_path_index() - Check for a path when the graph is not held in g.
+ * @sess: The session to query.
+ * @from: Index of the origin city.
+ * @to: Index of the destination city.
+ * @stats: Counters for this query.
  *
- * Returns: An integer with the number of unique cities.
+ * Returns: True if a path exists between the two cities.
  */
-int unique_cities(list *cities, list *edges){
-    list_pos P_edges = list_first(edges);
-    list_pos P_cities = list_first(cities);
-    int numCities = 0;
-   
-    // Goes through the full list of edges
-    while (P_edges != list_end(edges)) {
-        // Checks where to cut for the second substring call
-        int whereToCut = first_white_space(list_inspect(edges, P_edges));
-        int length2 = strlen(list_inspect(edges, P_edges))-whereToCut;
-        // Substrings into two different strings
-        char *city = substring(list_inspect(edges, P_edges), 1, whereToCut);
-        char *city2 = substring(list_inspect(edges, P_edges), whereToCut+2, length2);
-        if (!strcmp(city, "") || !strcmp(city2, ""))
-        {
-            fprintf(stderr, "ERROR: Bad file format!\n");
-            exit(EXIT_FAILURE);
-        }
-        
-        bool duplicate = false;
+bool find_path_index(session *sess, int from, int to, search_stats *stats){
+    if (sess->shm != NULL){
+        return searcher_find_path_shm(sess->search, sess->shm, from, to, stats);
+    }
+    if (sess->ext != NULL){
+        return extgraph_find_path(sess->ext, from, to, stats);
+    }
+    if (sess->uf != NULL){
+        return unionfind_connected(sess->uf, from, to, stats);
+    }
+    return cluster_find_path(sess->cluster, from, to, stats);
+}
 
-        // If the list is empty insert immediatly
-        if(list_is_empty(cities)){
-            // Check if city and city2 are the same, then free city2
-            if (!strcmp(city, city2))
-            {
-                list_insert(cities, city, list_end(cities));
-                free(city2);
-                numCities++;
-                P_edges = list_next(edges, P_edges);
-                continue;
-            } 
-            else // If they aren't the same, insert them both
-            {
-                list_insert(cities, city, list_end(cities));
-                numCities++;
-                list_insert(cities, city2, list_end(cities));
-                numCities++;
-                P_edges = list_next(edges, P_edges);
-                continue;
-            }  
-        }
-        P_cities = list_first(cities);
-        // Check if City1 is a duplicate, if not insert it
-        while (P_cities != list_end(cities)){
-            char *inspected_value = list_inspect(cities, P_cities);
-            // Check if the two are the same
-            if(!strcmp(city, inspected_value)){
-                free(city);
-                duplicate = true;
-                // Break out of the loops since a duplicate was found
-                break;
-            }
-            P_cities = list_next(cities, P_cities);
+/**
+ * answer_query() - Check for a path between two cities given by name.
+ * @ctx: The session to query.
+ * @origin: Name of the origin city.
+ * @dest: Name of the destination city.
+ *
+ * Adds the cost of the search to the session totals.
+ *
+ * Returns: 1 if there is a path, 0 if there is none and -1 if either
+ * city is not in the map.
+ */
+int answer_query(void *ctx, const char *origin, const char *dest){
+    session *sess = ctx;
+    search_stats queryStats;
+    bool invalidOrigin = true;
+    bool invalidDest = true;
+
+    if (sess->g == NULL){
+        // The graph is shared, on disk, split over the shard workers or
+        // only kept as connected sets
+        int from = lookup_city(sess, origin);
+        int to = lookup_city(sess, dest);
+        if (from < 0 || to < 0){
+            return -1;
         }
-        P_cities = list_first(cities);
-        // If they weren't the same, insert it into the list
-        if (!duplicate){
-            list_insert(cities, city, list_end(cities));
-            numCities++;
+        bool hasPath = find_path_index(sess, from, to, &queryStats);
+        stats_add(&sess->total, &queryStats);
+        if (sess->showStats){
+            stats_print(stderr, "query", &queryStats);
         }
-        
-        // Check if city2 is a duplicate, if not insert it
-        duplicate = false;
-        while (P_cities != list_end(cities))
-        {
-            char *inspected_value = list_inspect(cities, P_cities);
-            // Check if the two are the same
-            if(!strcmp(city2, inspected_value)){
-                free(city2);
-                duplicate = true;
-                // Break out of the loops since a duplicate was found
-                break;
-            }
-            P_cities = list_next(cities, P_cities);
+        return hasPath ? 1 : 0;
+    }
+    //Search the list of cities to confirm input exists
+    list_pos p = list_first(sess->cities);
+    for (int i = 0; i < sess->numberOfCities; i++) {
+        char *inspected_city = list_inspect(sess->cities, p);
+        if (!strcmp(origin, inspected_city)){
+            invalidOrigin = false;
         }
-        P_cities = list_first(cities);
-        // If they weren't the same, insert it into the list
-        if (!duplicate){
-            list_insert(cities, city2, list_end(cities));
-            numCities++;
+        if (!strcmp(dest, inspected_city)){
+            invalidDest = false;
         }
-        P_edges = list_next(edges, P_edges);
-    } 
-    return numCities;
+        p = list_next(sess->cities, p);
+    }
+    if (invalidOrigin || invalidDest){
+        return -1;
+    }
+    // Check if there is a path between the two choosen cities
+    bool hasPath = find_path(graph_find_node(sess->g, origin),
+                             graph_find_node(sess->g, dest), sess->g, sess->seen,
+                             &queryStats);
+    stats_add(&sess->total, &queryStats);
+    if (sess->total.queries % ALLOC_BATCH == 0){
+        alloc_report(stderr, "batch");
+    }
+    if (sess->showStats){
+        stats_print(stderr, "query", &queryStats);
+    }
+    return hasPath ? 1 : 0;
 }
 
 /**
- * add_nodes() - Adds all nodes into a graph.
- * @cities: A list of cities.
- * @g: Graph to add the nodes to.
+ * answer_reach() - List the cities that can reach a city.
+ * @sess: The session to query. Its graph keeps in-edges.
+ * @dest: Name of the destination city.
  *
- * Updates the graph g with the new nodes added to it.
+ * Prints the cities nearest first. Adds the cost of the search to the
+ * session totals.
  *
- * Returns: Nothing but updates the graph.
+ * Returns: The number of cities listed, or -1 if dest is not in the map.
  */
-void add_nodes(list *cities, graph *g){
-    list_pos q = list_first(cities);
-    while (q != list_end(cities)){
-        // Inserts the node into the graph
-        graph_insert_node(g, (char*)list_inspect(cities, q));
-        q = list_next(cities, q);
+int answer_reach(session *sess, const char *dest){
+    int to = strtab_lookup(sess->names, dest, strlen(dest));
+    if (to < 0){
+        return -1;
+    }
+    search_stats queryStats;
+    const int *nodes;
+    int count = searcher_reaching(sess->search, sess->g, graph_get_node(sess->g, to),
+                                  &nodes, &queryStats);
+    stats_add(&sess->total, &queryStats);
+    if (sess->showStats){
+        stats_print(stderr, "query", &queryStats);
     }
+    printf("%d %s can reach %s", count, count == 1 ? "city" : "cities", dest);
+    for (int i = 0; i < count; i++){
+        printf("%s%s", i == 0 ? ": " : ", ",
+               graph_node_name(sess->g, graph_get_node(sess->g, nodes[i])));
+    }
+    printf(".\n\n");
+    return count;
 }
 
 /**
- * add_neighbours() - Adds neighbouring cities to all nodes.
- * @l: A list of cities.
- * @g: Graph to inspect.
- *
- * Updates all nodes with their respective neighbours.
+ * follow_node() - Find or add the node for a city named in an appended line.
+ * @sess: The session being followed.
+ * @s: Name of the city, not '\0'-terminated.
+ * @len: Length of the name.
  *
- * Returns: Nothing but updates the graph.
+ * Returns: The node of the city.
  */
-void add_neighbours(list *l, graph *g){
-    list_pos P_edges = list_first(l);
-    
-    while (P_edges != list_end(l)) {
-        // Checks where to substring depending on the length of the first name
-        int whereToCut = first_white_space(list_inspect(l, P_edges));
-        int length2 = strlen(list_inspect(l, P_edges))-whereToCut;
-        // Gets the two cities and seperates them into two strings
-        char *col1 = substring(list_inspect(l, P_edges), 1, whereToCut);
-        char *col2 = substring(list_inspect(l, P_edges), whereToCut+2, length2);
-        // Finds the correct nodes in the graph
-        node *startNode = graph_find_node(g, col1);
-        node *destNode = graph_find_node(g, col2);
-        // If the two correct nodes are found, add them as neighbours
-        if (startNode != NULL && destNode != NULL)
-        {
-            graph_insert_edge(g, startNode, destNode);
-        }
-        P_edges = list_next(l, P_edges);
-        free(col1);
-        free(col2);
+node *follow_node(session *sess, const char *s, int len){
+    bool added;
+    int index = strtab_intern(sess->names, s, len, &added);
+    if (added){
+        // A new city, node indices follow the name ids
+        char *name = substring(s, 1, len);
+        graph_insert_node(sess->g, name);
+        list_insert(sess->cities, name, list_end(sess->cities));
+        sess->numberOfCities++;
     }
+    return graph_get_node(sess->g, index);
 }
+
 /**
- * find_path() - Check for a path between two nodes
- *               using width-first-method.
- * @n1: First node.
- * @n2: Second node.
- * @g: Graph to inspect.
+ * follow_edge() - Add an edge from a line appended to the map file.
+ * @ctx: The session being followed.
+ * @a: Name of the source city.
+ * @alen: Length of a.
+ * @b: Name of the destination city.
+ * @blen: Length of b.
  *
- * Returns a bool if there is a path between n1 & n2.
+ * Returns: Nothing.
+ */
+void follow_edge(void *ctx, const char *a, int alen, const char *b, int blen){
+    session *sess = ctx;
+    node *from = follow_node(sess, a, alen);
+    node *to = follow_node(sess, b, blen);
+    graph_insert_edge(sess->g, from, to);
+}
+
+/**
+ * follow_map() - Apply the lines appended to the map file to the graph.
+ * @sess: The session being followed.
  *
- * Returns: True if a path exists between the two nodes.
+ * Returns: Nothing.
  */
-bool find_path(node *n1, node *n2, graph *g){
-    queue *q = queue_empty(NULL);
-    //Mark origin node as seen
-    graph_node_set_seen(g, n1, true);
-    //Add origin node to queue
-    queue_enqueue(q, n1);
-    while (!queue_is_empty(q))
-    {
-        node *p = queue_front(q);
-        q = queue_dequeue(q);
-        //Retrive current node's neighbours
-        dlist *neighbours = graph_neighbours(g, p);
-        dlist_pos pos = dlist_first(neighbours);
-        //Inspect all neighbours
-        while (!dlist_is_end(neighbours, pos))
-        {
-            //Mark the neighbours as seen if not already
-            if (!graph_node_is_seen(g, dlist_inspect(neighbours, pos)))
-            {
-                graph_node_set_seen(g, dlist_inspect(neighbours, pos), true);
-                //Add current node's neighbours to queue
-                queue_enqueue(q, dlist_inspect(neighbours, pos));
-            }
-            pos = dlist_next(neighbours, pos);
-        }
-        dlist_kill(neighbours);
+void follow_map(session *sess){
+    int before = sess->numberOfCities;
+    int edges = follow_poll(sess->follow, follow_edge, sess);
+    if (graph_component_count(sess->g) == 0){
+        // New edges joined components, or new cities were added
+        graph_label_components(sess->g);
     }
-    queue_kill(q);
-    //Return true if the destination node was seen
-    if (graph_node_is_seen(g, n2))
+    if (edges > 0 && sess->showStats){
+        fprintf(stderr, "follow: new edges=%d new nodes=%d\n",
+                edges, sess->numberOfCities - before);
+    }
+}
+
+/**
+ * free_strings() - Free a list and the strings in it.
+ * @l: List of strings from alloc_malloc().
+ *
+ * Returns: Nothing.
+ */
+void free_strings(list *l){
+    list_pos pos = list_first(l);
+    while (pos != list_end(l))
     {
-        return true;
+        alloc_free(list_inspect(l, pos));
+        pos = list_next(l, pos);
     }
-    return false;
+    list_kill(l);
 }
 
+/**
+ * free_session() - Return the memory held by a session.
+ * @sess: Session to free.
+ *
+ * Returns: Nothing.
+ */
+void free_session(session *sess){
+    if (sess->shm != NULL){
+        searcher_kill(sess->search);
+        shmgraph_detach(sess->shm);
+        return;
+    }
+    if (sess->ext != NULL){
+        extgraph_kill(sess->ext);
+        return;
+    }
+    if (sess->uf != NULL){
+        unionfind_kill(sess->uf);
+        return;
+    }
+    if (sess->cluster != NULL){
+        cluster_stop(sess->cluster);
+        return;
+    }
+    if (sess->follow != NULL){
+        follow_stop(sess->follow);
+    }
+    if (sess->names != NULL){
+        strtab_kill(sess->names, true);
+    }
+    if (sess->search != NULL){
+        searcher_kill(sess->search);
+    }
+    free_strings(sess->cities);
+    bitset_kill(sess->seen);
+    graph_kill(sess->g);
+}
 
-int main(int argc, const char **argv)
-{
-    FILE *in;
-    const char *map;
-    //Verify number of parameters
-    if (argc <= 1){
-        fprintf(stderr, "Usage: ./isConnected airmap1.map\n");
+/**
+ * replay() - Re-run a captured query log against a session.
+ * @sess: The session to query.
+ * @file: Name of the query log.
+ * @paced: If true, keep the original pacing of the queries.
+ * @latency: Histogram receiving the time of each query.
+ *
+ * Reports throughput and latency on stdout.
+ *
+ * Returns: 0 if every answer matched the log, otherwise -1.
+ */
+int replay(session *sess, const char *file, bool paced, histogram *latency){
+    replay_result res;
+    FILE *in = fopen(file, "r");
+    if (in == NULL){
+        fprintf(stderr, "Failed to open %s for reading: %s\n", file, strerror(errno));
         return -1;
     }
-    //Try to open input file
-    map = argv[1];
-    in = fopen(map, "r");
-    if (in == NULL){
-        fprintf(stderr, "Failed to open %s for reading: %s\n", map, strerror(errno));
+    bool ok = qlog_replay(in, paced, answer_query, sess, latency, &res);
+    fclose(in);
+    if (!ok){
+        fprintf(stderr, "ERROR: Bad query log %s!\n", file);
         return -1;
     }
+    printf("replay: queries=%" PRIu64 " mismatches=%" PRIu64 " time=%.6fs throughput=%.1f/s\n",
+           res.queries, res.mismatches, res.elapsed,
+           res.elapsed > 0 ? res.queries / res.elapsed : 0.0);
+    histogram_report(stdout, "latency", latency);
+    if (sess->showStats){
+        stats_print(stderr, "total", &sess->total);
+    }
+    return res.mismatches == 0 ? 0 : -1;
+}
 
-    // Create lists ..
-    list *edges = list_empty(NULL);
-    read_file(in, edges);
-
-    // Gets the amount of unique cities
-    list *cities = list_empty(NULL);
-    int numberOfCities = unique_cities(cities, edges);
-
-    // Create a graph based on the amount of unique cities
-    graph *g = graph_empty(numberOfCities);
-
-    // Add nodes to all nodes
-    add_nodes(cities, g);
-    
-    
-    // Insert neighbours into the graph
-    add_neighbours(edges, g);
+/**
+ * query_loop() - Answer origin and destination pairs typed on stdin.
+ * @sess: The session to query.
+ * @queryLog: File to log the queries to, or NULL.
+ * @latencyDump: File to dump the latency histogram to, or NULL.
+ * @latency: Histogram receiving the time of each query.
+ *
+ * Runs until the user types "quit".
+ *
+ * Returns: 0.
+ */
+int query_loop(session *sess, const char *queryLog, const char *latencyDump,
+               histogram *latency){
+    qlog *log = NULL;
+    if (queryLog != NULL){
+        log = qlog_create(queryLog);
+        if (log == NULL){
+            fprintf(stderr, "Failed to open %s for writing: %s\n", queryLog, strerror(errno));
+        }
+    }
 
     // Create required elements
     char origin[40];
     char dest[40];
-    list_pos p;
-    bool invalidOrigin;
-    bool invalidDest;
+    double queryStart;
     //Asks some user input
     while (1){
         printf("Enter origin and destination (quit to exit): ");
         // Get origin and destination information from the user
         scanf("%s", origin);
         // If the user typed "quit", exit the program
-        if (strcmp(origin, "quit")){
+        if (sess->search != NULL && sess->g != NULL && !strcmp(origin, "reach")){
+            // "reach X" lists every city with a path to X
+            scanf("%s", dest);
+            if (sess->follow != NULL){
+                follow_map(sess);
+            }
+            queryStart = stats_now();
+            TRACE_BEGIN("reach");
+            int result = answer_reach(sess, dest);
+            TRACE_END("reach");
+            if (result >= 0){
+                histogram_record(latency, (uint64_t)((stats_now() - queryStart) * 1e9));
+            } else {
+                fprintf(stderr, "Invalid input. Try again\n\n");
+            }
+        } else if (strcmp(origin, "quit")){
             scanf("%s", dest);
-            invalidOrigin = true;
-            invalidDest = true;
-
-            //Search the list of cities to confirm input exists
-            p = list_first(cities);
-            for (int i = 0; i < numberOfCities; i++) {
-                char *inspected_city = list_inspect(cities, p);
-                if (!strcmp(origin, inspected_city)){
-                    invalidOrigin = false;
-                }
-                if (!strcmp(dest, inspected_city)){
-                    invalidDest = false;
-                }
-                p = list_next(cities, p);
+            if (sess->follow != NULL){
+                follow_map(sess);
+            }
+            queryStart = stats_now();
+            TRACE_BEGIN("query");
+            int result = answer_query(sess, origin, dest);
+            if (result >= 0){
+                histogram_record(latency, (uint64_t)((stats_now() - queryStart) * 1e9));
             }
-            if (!invalidOrigin && !invalidDest){
-                // Check if there is a path between the two choosen cities
-                bool hasPath = find_path(graph_find_node(g, origin), graph_find_node(g, dest), g);
-                if (hasPath)
-                {
-                    printf("There is a path from %s to %s.\n\n", origin, dest);
-                } else
-                {
-                    printf("There is no path from %s to %s.\n\n", origin, dest);
-                }
-                // Reset all nodes seen status to false
-                graph_reset_seen(g);
-            }else{
+            TRACE_END("query");
+            if (log != NULL){
+                qlog_record(log, origin, dest, result);
+            }
+            if (result > 0)
+            {
+                printf("There is a path from %s to %s.\n\n", origin, dest);
+            } else if (result == 0)
+            {
+                printf("There is no path from %s to %s.\n\n", origin, dest);
+            } else {
                 fprintf(stderr, "Invalid input. Try again\n\n");
             }
         } else{
@@ -453,30 +535,586 @@ int main(int argc, const char **argv)
         }
     }
     printf("Normal exit.\n");
-
-    // Cleanup time
-    list_pos pos = list_first(cities);
-    while (pos != list_end(cities))
-    {
-        free(list_inspect(cities, pos));
-        pos = list_next(cities, pos);
+    if (log != NULL){
+        qlog_kill(log);
     }
-    list_kill(cities);
-    
-    pos = list_first(edges);
-    while (pos != list_end(edges))
-    {
-        free(list_inspect(edges, pos));
-        pos = list_next(edges, pos);
+    if (sess->showStats){
+        stats_print(stderr, "total", &sess->total);
+        histogram_report(stderr, "latency", latency);
     }
-    list_kill(edges);
-
+    if (latencyDump != NULL){
+        FILE *out = fopen(latencyDump, "w");
+        if (out == NULL){
+            fprintf(stderr, "Failed to open %s for writing: %s\n", latencyDump, strerror(errno));
+        } else {
+            histogram_write(out, latency);
+            fclose(out);
+        }
+    }
+    return 0;
+}
 
-    graph_kill(g);
+/**
+ * finish_run() - Report memory use, end the trace and close the map.
+ * @in: The map file.
+ * @map: Name of the map file, for the error message.
+ * @status: Exit status so far.
+ *
+ * Returns: The exit status of the program, -1 if the map could not be
+ * closed.
+ */
+int finish_run(FILE *in, const char *map, int status){
+    alloc_report(stderr, "exit");
+    TRACE_CLOSE();
     //Try to close input file
     if (fclose(in)){
         fprintf(stderr, "Failed to close %s: %s", map, strerror(errno));
         return -1;
     }
+    return status;
+}
+
+/**
+ * run_session() - Answer queries against a graph that was not loaded
+ *                 into memory, then free the session.
+ * @sess: The session to query.
+ * @replayLog: Query log to replay, or NULL to ask on stdin.
+ * @paced: If true, keep the original pacing of a replay.
+ * @queryLog: File to log the queries to, or NULL.
+ * @latencyDump: File to dump the latency histogram to, or NULL.
+ *
+ * Returns: The exit status of the program.
+ */
+int run_session(session *sess, const char *replayLog, bool paced,
+                const char *queryLog, const char *latencyDump){
+    histogram *latency = histogram_empty();
+    int status = replayLog != NULL ? replay(sess, replayLog, paced, latency)
+                                   : query_loop(sess, queryLog, latencyDump, latency);
+    alloc_free(latency);
+    free_session(sess);
+    alloc_report(stderr, "exit");
+    TRACE_CLOSE();
+    return status;
+}
+
+/**
+ * parse_size() - Read a size such as 4096, 512K, 64M or 2G.
+ * @s: String to read.
+ * @size: Set to the size in bytes.
+ *
+ * Returns: True if s is a size, otherwise false.
+ */
+bool parse_size(const char *s, size_t *size){
+    char *end;
+    errno = 0;
+    unsigned long long value = strtoull(s, &end, 10);
+    if (end == s || errno != 0 || s[0] == '-'){
+        return false;
+    }
+    int shift = 0;
+    switch (toupper((unsigned char)*end)){
+    case 'G': shift += 10; /* fall through */
+    case 'M': shift += 10; /* fall through */
+    case 'K': shift += 10; end++; break;
+    default: break;
+    }
+    if (*end != '\0' || value > (SIZE_MAX >> shift)){
+        return false;
+    }
+    *size = (size_t)value << shift;
+    return true;
+}
+
+/**
+ * print_components() - Print the number and sizes of the components.
+ * @g: Labelled graph.
+ * @seconds: Time taken to label the graph.
+ *
+ * Only the largest sizes are listed, in falling order.
+ *
+ * Returns: Nothing.
+ */
+void print_components(const graph *g, double seconds){
+    int largest[COMPONENTS_LISTED];
+    int listed = 0;
+    int singletons = 0;
+    int count = graph_component_count(g);
+    for (int c = 0; c < count; c++){
+        int size = graph_component_size(g, c);
+        singletons += size == 1;
+        if (listed < COMPONENTS_LISTED){
+            largest[listed++] = size;
+        } else if (size > largest[listed - 1]){
+            largest[listed - 1] = size;
+        } else {
+            continue;
+        }
+        // Move the new size up to keep the list in falling order
+        for (int k = listed - 1; k > 0 && largest[k - 1] < largest[k]; k--){
+            int tmp = largest[k - 1];
+            largest[k - 1] = largest[k];
+            largest[k] = tmp;
+        }
+    }
+    fprintf(stderr, "components: count=%d singletons=%d sizes=", count, singletons);
+    for (int k = 0; k < listed; k++){
+        fprintf(stderr, "%s%d", k > 0 ? "," : "", largest[k]);
+    }
+    fprintf(stderr, "%s time=%.6fs\n", count > listed ? ",..." : "", seconds);
+}
+
+/**
+ * usage() - Print the command line syntax.
+ *
+ * Returns: Nothing.
+ */
+void usage(void){
+    fprintf(stderr, "Usage: ./isConnected [--stats] [--latency-dump file] [--trace file]\n"
+                    "                     [--query-log file] [--threads n | --pipeline] [--order how] [--compact]\n"
+                    "                     [--reverse] airmap1.map\n"
+                    "       ./isConnected [--stats] --follow [--threads n] [--order how] [--reverse] airmap1.map\n"
+                    "       ./isConnected [--stats] --replay log [--paced] [--order how] [--compact]\n"
+                    "                     airmap1.map\n"
+                    "       ./isConnected [--stats] --serve socket [--workers n] [--order how] [--compact]\n"
+                    "                     airmap1.map\n"
+                    "       ./isConnected [--stats] --shm-build name [--threads n | --pipeline] [--order how]\n"
+                    "                     airmap1.map\n"
+                    "       ./isConnected [--stats] [--latency-dump file] [--query-log file]\n"
+                    "                     [--replay log [--paced]] --shm name\n"
+                    "       ./isConnected --shm-unlink name\n"
+                    "       ./isConnected [--stats] [--latency-dump file] [--query-log file]\n"
+                    "                     [--replay log [--paced]] --external dir [--memory size] airmap1.map\n"
+                    "       ./isConnected [--stats] [--latency-dump file] [--query-log file]\n"
+                    "                     [--replay log [--paced]] --shards n airmap1.map\n"
+                    "       ./isConnected [--stats] [--latency-dump file] [--query-log file]\n"
+                    "                     [--replay log [--paced]] --undirected airmap1.map\n"
+                    "       ./isConnected --latency-merge dump...\n"
+                    "The order how is bfs, rcm or degree. With --reverse, \"reach city\" lists the\n"
+                    "cities that can reach the city. A map whose first line is \"# undirected\" is\n"
+                    "loaded as with --undirected when no option needs the whole graph.\n");
+}
+
+/**
+ * merge_latency_dumps() - Merge latency dumps and report percentiles.
+ * @count: Number of dump files.
+ * @files: Names of the dump files.
+ *
+ * Returns: 0 on success, -1 if a dump could not be read.
+ */
+int merge_latency_dumps(int count, const char **files){
+    histogram *h = histogram_empty();
+    for (int i = 0; i < count; i++){
+        FILE *in = fopen(files[i], "r");
+        if (in == NULL){
+            fprintf(stderr, "Failed to open %s for reading: %s\n", files[i], strerror(errno));
+            alloc_free(h);
+            return -1;
+        }
+        bool ok = histogram_read(in, h);
+        fclose(in);
+        if (!ok){
+            fprintf(stderr, "ERROR: Bad latency dump %s!\n", files[i]);
+            alloc_free(h);
+            return -1;
+        }
+    }
+    histogram_report(stdout, "latency", h);
+    alloc_free(h);
     return 0;
+}
+
+int main(int argc, const char **argv)
+{
+    FILE *in;
+    const char *map = NULL;
+    const char *latencyDump = NULL;
+    const char *traceFile = NULL;
+    const char *queryLog = NULL;
+    const char *replayLog = NULL;
+    bool paced = false;
+    int threads = -1;
+    bool pipelined = false;
+    const char *socketPath = NULL;
+    int workers = 0;
+    bool follow = false;
+    const char *shmBuild = NULL;
+    const char *shmName = NULL;
+    const char *externalDir = NULL;
+    size_t memory = EXTERNAL_MEMORY;
+    int shards = 0;
+    bool compact = false;
+    bool reverse = false;
+    bool undirected = false;
+    graph_order order = ORDER_NONE;
+    bool showStats = false;
+    bool badArgs = false;
+    //Parse options, the remaining parameter is the map
+    for (int i = 1; i < argc; i++){
+        if (!strcmp(argv[i], "--stats")){
+            showStats = true;
+        } else if (!strcmp(argv[i], "--latency-dump") && i + 1 < argc){
+            latencyDump = argv[++i];
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc){
+            traceFile = argv[++i];
+        } else if (!strcmp(argv[i], "--query-log") && i + 1 < argc){
+            queryLog = argv[++i];
+        } else if (!strcmp(argv[i], "--replay") && i + 1 < argc){
+            replayLog = argv[++i];
+        } else if (!strcmp(argv[i], "--paced")){
+            paced = true;
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc){
+            threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--pipeline")){
+            pipelined = true;
+        } else if (!strcmp(argv[i], "--order") && i + 1 < argc){
+            badArgs |= !reorder_parse(argv[++i], &order);
+        } else if (!strcmp(argv[i], "--reverse")){
+            reverse = true;
+        } else if (!strcmp(argv[i], "--undirected")){
+            undirected = true;
+        } else if (!strcmp(argv[i], "--compact")){
+            compact = true;
+        } else if (!strcmp(argv[i], "--follow")){
+            follow = true;
+        } else if (!strcmp(argv[i], "--serve") && i + 1 < argc){
+            socketPath = argv[++i];
+        } else if (!strcmp(argv[i], "--workers") && i + 1 < argc){
+            workers = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--shm-build") && i + 1 < argc){
+            shmBuild = argv[++i];
+        } else if (!strcmp(argv[i], "--shm") && i + 1 < argc){
+            shmName = argv[++i];
+        } else if (!strcmp(argv[i], "--external") && i + 1 < argc){
+            externalDir = argv[++i];
+        } else if (!strcmp(argv[i], "--memory") && i + 1 < argc){
+            badArgs |= !parse_size(argv[++i], &memory);
+        } else if (!strcmp(argv[i], "--shards") && i + 1 < argc){
+            shards = atoi(argv[++i]);
+            badArgs |= shards < 1;
+        } else if (!strcmp(argv[i], "--shm-unlink") && i + 1 < argc){
+            return shmgraph_unlink(argv[i + 1]) == 0 ? 0 : -1;
+        } else if (!strcmp(argv[i], "--latency-merge") && i + 1 < argc){
+            return merge_latency_dumps(argc - i - 1, argv + i + 1);
+        } else if (map == NULL && argv[i][0] != '-'){
+            map = argv[i];
+        } else {
+            badArgs = true;
+        }
+    }
+    // Options that need the edges themselves rule out undirected mode
+    bool wholeGraph = socketPath != NULL || follow || shmBuild != NULL || externalDir != NULL ||
+                      shards > 0 || reverse || compact || order != ORDER_NONE ||
+                      threads >= 0 || pipelined;
+    //Verify number of parameters. An attached shared graph replaces the map.
+    if ((map == NULL) == (shmName == NULL) || badArgs ||
+        (follow && (socketPath != NULL || replayLog != NULL || compact)) ||
+        (shmBuild != NULL && (socketPath != NULL || replayLog != NULL || follow)) ||
+        (reverse && (socketPath != NULL || shmBuild != NULL || shmName != NULL ||
+                     externalDir != NULL || shards > 0)) ||
+        (shmName != NULL && (socketPath != NULL || follow || threads >= 0 || pipelined ||
+                             compact || order != ORDER_NONE)) ||
+        (externalDir != NULL && (socketPath != NULL || follow || shmBuild != NULL ||
+                                 shmName != NULL || threads >= 0 || pipelined || compact ||
+                                 order != ORDER_NONE)) ||
+        (shards > 0 && (socketPath != NULL || follow || shmBuild != NULL ||
+                        shmName != NULL || externalDir != NULL || threads >= 0 ||
+                        pipelined || compact || order != ORDER_NONE)) ||
+        (undirected && (wholeGraph || shmName != NULL))){
+        usage();
+        return -1;
+    }
+
+    session sess;
+    sess.showStats = showStats;
+    sess.follow = NULL;
+    sess.names = NULL;
+    sess.shm = NULL;
+    sess.search = NULL;
+    sess.ext = NULL;
+    sess.cluster = NULL;
+    sess.uf = NULL;
+    sess.g = NULL;
+    sess.seen = NULL;
+    stats_reset(&sess.total);
+
+    if (shmName != NULL){
+        // Another process has built the graph, start answering at once
+        double attachStart = stats_now();
+        sess.shm = shmgraph_attach(shmName);
+        if (sess.shm == NULL){
+            return -1;
+        }
+        sess.search = searcher_empty();
+        if (showStats){
+            fprintf(stderr, "attach: nodes=%d edges=%d bytes=%zu time=%.6fs\n",
+                    shmgraph_node_count(sess.shm), shmgraph_edge_count(sess.shm),
+                    shmgraph_size(sess.shm), stats_now() - attachStart);
+        }
+        return run_session(&sess, replayLog, paced, queryLog, latencyDump);
+    }
+
+    //Try to open input file
+    in = fopen(map, "r");
+    if (in == NULL){
+        fprintf(stderr, "Failed to open %s for reading: %s\n", map, strerror(errno));
+        return -1;
+    }
+
+    if (shards > 0){
+        // Fork the workers while this process is still small, so they
+        // do not keep the pages of the map
+        sess.cluster = cluster_start(shards);
+        if (sess.cluster == NULL){
+            fclose(in);
+            return -1;
+        }
+    }
+
+    if (traceFile != NULL && !TRACE_OPEN(traceFile)){
+        fprintf(stderr, "Failed to start trace %s (tracing needs a -DTRACE build)\n", traceFile);
+    }
+
+    double loadStart = stats_now();
+    TRACE_BEGIN("load");
+
+    // Create lists ..
+    list *cities = list_empty(NULL);
+    int numberOfCities;
+    int numberOfEdges;
+    graph *g;
+
+    // Recognize compressed maps by their first bytes
+    source *src = source_open(in);
+    if (src == NULL){
+        if (sess.cluster != NULL){
+            cluster_stop(sess.cluster);
+        }
+        list_kill(cities);
+        fclose(in);
+        return -1;
+    }
+
+    // The map may say that it is undirected, which the source must be
+    // peeked at for before it is read
+    if (!undirected && !wholeGraph){
+        undirected = map_is_undirected(src);
+    }
+
+    if (sess.cluster != NULL){
+        // Stream the edges into the shards, no graph is built here
+        bool loaded = cluster_load(sess.cluster, src, showStats);
+        source_close(src);
+        list_kill(cities);
+        fclose(in);
+        if (!loaded){
+            cluster_stop(sess.cluster);
+            exit(EXIT_FAILURE);
+        }
+        TRACE_END("load");
+        if (showStats){
+            fprintf(stderr, "load: nodes=%d edges=%d time=%.6fs\n",
+                    cluster_node_count(sess.cluster), cluster_edge_count(sess.cluster),
+                    stats_now() - loadStart);
+        }
+        alloc_report(stderr, "shards");
+        return run_session(&sess, replayLog, paced, queryLog, latencyDump);
+    }
+
+    if (externalDir != NULL){
+        // Sort the edges on disk, only the names are kept in memory
+        sess.ext = extgraph_build(src, externalDir, memory);
+        source_close(src);
+        list_kill(cities);
+        fclose(in);
+        if (sess.ext == NULL){
+            exit(EXIT_FAILURE);
+        }
+        TRACE_END("load");
+        if (showStats){
+            fprintf(stderr, "load: nodes=%d edges=%d time=%.6fs\n",
+                    extgraph_node_count(sess.ext), extgraph_edge_count(sess.ext),
+                    stats_now() - loadStart);
+        }
+        alloc_report(stderr, "load");
+        return run_session(&sess, replayLog, paced, queryLog, latencyDump);
+    }
+
+    if (undirected){
+        // Join the cities into sets as the edges are read, no edge is kept
+        sess.uf = unionfind_load(src);
+        source_close(src);
+        list_kill(cities);
+        fclose(in);
+        if (sess.uf == NULL){
+            exit(EXIT_FAILURE);
+        }
+        TRACE_END("load");
+        if (showStats){
+            fprintf(stderr, "load: nodes=%d edges=%d sets=%d time=%.6fs\n",
+                    unionfind_node_count(sess.uf), unionfind_edge_count(sess.uf),
+                    unionfind_set_count(sess.uf), stats_now() - loadStart);
+        }
+        alloc_report(stderr, "load");
+        return run_session(&sess, replayLog, paced, queryLog, latencyDump);
+    }
+
+    // A pipe can only be read once and a compressed map must be
+    // decompressed on the way, so both are always streamed
+    struct stat st;
+    if (source_is_compressed(src) ||
+        (fstat(fileno(in), &st) == 0 && !S_ISREG(st.st_mode))){
+        pipelined = true;
+    }
+
+    if (pipelined){
+        // Overlap reading, parsing and building on three threads
+        g = load_map_pipelined(src, cities, &numberOfCities, &numberOfEdges);
+    } else if (threads >= 0){
+        // Tokenize the file on several threads, 0 means all cores
+        g = load_map_parallel(in, threads, cities, &numberOfCities, &numberOfEdges);
+    } else {
+        // Create the graph and its nodes as the cities turn up
+        g = load_map_sequential(src, cities, &numberOfCities, &numberOfEdges);
+    }
+    bool compressed = source_is_compressed(src);
+    source_close(src);
+    if (g == NULL){
+        // The loader has already reported why
+        exit(EXIT_FAILURE);
+    }
+    TRACE_END("load");
+    if (showStats){
+        fprintf(stderr, "load: nodes=%d edges=%d time=%.6fs\n",
+                numberOfCities, numberOfEdges, stats_now() - loadStart);
+    }
+    alloc_report(stderr, "load");
+
+    // Merged maps list many routes twice, keep each edge once
+    double dedupStart = stats_now();
+    int removed = graph_remove_duplicates(g);
+    numberOfEdges -= removed;
+    if (showStats){
+        fprintf(stderr, "dedup: removed=%d edges=%d time=%.6fs\n",
+                removed, numberOfEdges, stats_now() - dedupStart);
+    }
+
+    // Most "no path" answers are between separate clusters, which the
+    // component labels answer without flooding the origin's cluster
+    double componentStart = stats_now();
+    graph_label_components(g);
+    if (showStats){
+        print_components(g, stats_now() - componentStart);
+    }
+
+    if (order != ORDER_NONE){
+        // Number the nodes so that neighbours lie close in memory
+        double orderStart = stats_now();
+        bandwidth before = reorder_bandwidth(g);
+        reorder_graph(g, order);
+        if (showStats){
+            bandwidth after = reorder_bandwidth(g);
+            fprintf(stderr, "order: %s bandwidth=%d->%d mean=%.1f->%.1f time=%.6fs\n",
+                    reorder_name(order), before.max, after.max, before.mean, after.mean,
+                    stats_now() - orderStart);
+        }
+    }
+
+    if (reverse){
+        // Answer "reach" queries by searching the in-edges
+        graph_keep_in_edges(g);
+        alloc_report(stderr, "reverse");
+    }
+
+    if (compact){
+        // The graph is only read from here on, pack the neighbour lists
+        double compactStart = stats_now();
+        graph_compact(g);
+        if (showStats){
+            fprintf(stderr, "compact: edges=%d bytes=%zu bytes/edge=%.2f time=%.6fs\n",
+                    numberOfEdges, graph_edge_bytes(g),
+                    numberOfEdges > 0 ? (double)graph_edge_bytes(g) / numberOfEdges : 0.0,
+                    stats_now() - compactStart);
+        }
+        alloc_report(stderr, "compact");
+    } else if (!follow){
+        // Small dense maps are both smaller and faster as a bit matrix
+        double matrixStart = stats_now();
+        if (graph_choose_matrix(g)){
+            if (showStats){
+                fprintf(stderr, "matrix: nodes=%d edges=%d density=%.3f bytes=%zu time=%.6fs\n",
+                        numberOfCities, numberOfEdges,
+                        (double)numberOfEdges / numberOfCities / numberOfCities,
+                        graph_edge_bytes(g), stats_now() - matrixStart);
+            }
+            alloc_report(stderr, "matrix");
+        }
+    }
+
+    sess.g = g;
+    sess.cities = cities;
+    sess.numberOfCities = numberOfCities;
+
+    if (shmBuild != NULL){
+        // Write the graph out for other processes and stop
+        size_t bytes;
+        int status = shmgraph_build(shmBuild, g, &bytes);
+        if (status == 0 && showStats){
+            fprintf(stderr, "shm: name=%s nodes=%d edges=%d bytes=%zu\n",
+                    shmBuild, numberOfCities, numberOfEdges, bytes);
+        }
+        free_session(&sess);
+        return finish_run(in, map, status);
+    }
+
+    histogram *latency = histogram_empty();
+
+    if (socketPath != NULL){
+        // Answer clients on the socket instead of stdin. The server
+        // takes over the graph, since a reload replaces it.
+        int status = server_run(socketPath, map, g, cities, order, workers, showStats);
+        alloc_free(latency);
+        return finish_run(in, map, status);
+    }
+
+    sess.seen = bitset_empty();
+
+    if (replayLog != NULL){
+        int status = replay(&sess, replayLog, paced, latency);
+        alloc_free(latency);
+        free_session(&sess);
+        return finish_run(in, map, status);
+    }
+
+    if (follow){
+        // Appended lines are applied before each query
+        if (compressed){
+            fprintf(stderr, "ERROR: Only a regular, uncompressed map file can be followed!\n");
+        } else {
+            sess.follow = follow_start(in, map);
+        }
+        if (sess.follow == NULL){
+            alloc_free(latency);
+            free_session(&sess);
+            return finish_run(in, map, -1);
+        }
+    }
+
+    if (follow || reverse){
+        // Look up cities by name without a scan over all of them
+        sess.names = strtab_empty(numberOfCities);
+        for (int i = 0; i < numberOfCities; i++){
+            const char *name = graph_node_name(g, graph_get_node(g, i));
+            strtab_intern(sess.names, name, strlen(name), NULL);
+        }
+    }
+    if (reverse){
+        sess.search = searcher_empty();
+    }
+
+    query_loop(&sess, queryLog, latencyDump, latency);
+    alloc_free(latency);
+
+    // Cleanup time
+    free_session(&sess);
+    return finish_run(in, map, 0);
 }
\ No newline at end of file
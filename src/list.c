@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "alloc.h"
 #include "list.h"
 
 /*
@@ -49,11 +50,11 @@ struct list {
 list *list_empty(free_function free_func)
 {
 	// Allocate memory for the list head.
-	list *l = calloc(1, sizeof(list));
+	list *l = alloc_calloc(ALLOC_LIST, 1, sizeof(list));
 
 	// Allocate memory for the border cells.
-	l->top = calloc(1, sizeof(struct cell));
-	l->bottom = calloc(1, sizeof(struct cell));
+	l->top = alloc_calloc(ALLOC_LIST, 1, sizeof(struct cell));
+	l->bottom = alloc_calloc(ALLOC_LIST, 1, sizeof(struct cell));
 
 	// Set consistent links between border elements.
 	l->top->next = l->bottom;
@@ -172,7 +173,7 @@ void *list_inspect(const list * l, const list_pos p)
 list_pos list_insert(list * l, void *v, const list_pos p)
 {
 	// Allocate memory for a new cell.
-	list_pos elem = malloc(sizeof(struct cell));
+	list_pos elem = alloc_malloc(ALLOC_LIST, sizeof(struct cell));
 
 	// Store the value.
 	elem->value = v;
@@ -211,7 +212,7 @@ list_pos list_remove(const list * l, const list_pos p)
 		l->free_func(p->value);
 	}
 	// Free the memory allocated to the cell itself.
-	free(p);
+	alloc_free(p);
 	// Return the position of the next element.
 	return next_pos;
 }
@@ -240,9 +241,9 @@ void list_kill(list * l)
 	}
 
 	// Free border elements and the list head.
-	free(l->top);
-	free(l->bottom);
-	free(l);
+	alloc_free(l->top);
+	alloc_free(l->bottom);
+	alloc_free(l);
 }
 
 /**
@@ -0,0 +1,643 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "alloc.h"
+#include "list.h"
+#include "graph.h"
+#include "strtab.h"
+#include "trace.h"
+#include "scan.h"
+#include "loader.h"
+
+/*
+ * Implementation of the parallel map loader.
+ */
+
+// Most threads the loader will start.
+#define MAX_THREADS 256
+
+/*
+ * One newline-aligned part of the file and everything derived from it.
+ * Edges are first stored with chunk-local name ids and are rewritten to
+ * global ids once the name tables have been merged.
+ */
+typedef struct chunk {
+    const char *begin;
+    const char *end;
+    strtab *names;     // Names first seen in this chunk, in order.
+    int *src;          // Source id of each edge.
+    int *dst;          // Destination id of each edge.
+    int numEdges;
+    int capEdges;
+    int *map;          // Local name id -> global name id.
+    int *buckets;      // Edges per source range, later offsets in pairs.
+    int width;         // Number of source ids in a range.
+    int *pairs;        // Shared (source, destination) pairs by range.
+    bool bad;          // Set if a badly formatted line was found.
+} chunk;
+
+/*
+ * A range of source ids and the pairs whose source lies in it, in file
+ * order. The range sorts its pairs into its part of the shared offset
+ * and destination arrays.
+ */
+typedef struct range {
+    int lo;            // First source id.
+    int hi;            // One past the last source id.
+    int begin;         // First pair of the range.
+    int end;           // One past the last pair.
+    int *pairs;
+    int *start;        // Offset of each source's destinations.
+    int *sorted;       // Destinations grouped by source.
+} range;
+
+/*
+ * Bytes classified at a time by map_scan_lines(). Every line piece is
+ * at most BUFSIZE-1 bytes, so a piece starting inside a window ends
+ * within SCAN_LOOKAHEAD bytes after it.
+ */
+#define SCAN_WINDOW (1 << 16)
+#define SCAN_LOOKAHEAD 320
+
+// Bytes of the map read at a time by load_map_sequential().
+#define READ_SIZE (1 << 16)
+
+// State of load_map_sequential() while the map is scanned.
+typedef struct builder {
+    graph *g;
+    strtab *names;     // Node names by index.
+    int numEdges;
+} builder;
+
+/**
+ * map_scan_lines() - Find the edges in a range of map file lines.
+ * @begin: Start of the first line.
+ * @end: End of the range, just after a newline or at the end of file.
+ * @cb: Function called with the two city names of each edge.
+ * @ctx: Passed on to cb.
+ *
+ * The bytes are classified once with scan_classify() and every piece of
+ * a line is then examined with bit scans. A piece is what fgets() with
+ * BUFSIZE returns, and the rules are those of the fgets() based reader
+ * the map format was first defined by: blank lines, comment lines and lines starting with a
+ * digit are skipped, the line is cut one character before the first '#'
+ * or else before its last character, and the first white-space splits
+ * the names.
+ *
+ * Returns: True if all lines were well formed, otherwise false.
+ */
+bool map_scan_lines(const char *begin, const char *end, edge_callback cb, void *ctx){
+    uint64_t nl[SCAN_WORDS(SCAN_WINDOW + SCAN_LOOKAHEAD)];
+    uint64_t ws[SCAN_WORDS(SCAN_WINDOW + SCAN_LOOKAHEAD)];
+    uint64_t hash[SCAN_WORDS(SCAN_WINDOW + SCAN_LOOKAHEAD)];
+    const char *base = begin;
+
+    while (base < end)
+    {
+        size_t avail = end - base;
+        size_t span = avail < SCAN_WINDOW + SCAN_LOOKAHEAD ? avail : SCAN_WINDOW + SCAN_LOOKAHEAD;
+        size_t stop = avail < SCAN_WINDOW ? avail : SCAN_WINDOW;
+        scan_classify(base, span, nl, ws, hash);
+
+        size_t s = 0;
+        while (s < stop)
+        {
+            // A piece ends after its newline or after BUFSIZE-1 bytes
+            size_t limit = s + BUFSIZE - 1 < span ? s + BUFSIZE - 1 : span;
+            size_t pieceEnd = scan_next(nl, s, limit);
+            pieceEnd = pieceEnd < limit ? pieceEnd + 1 : limit;
+            size_t first = scan_next_clear(ws, s, pieceEnd);
+            // Skip blank lines, comment lines and integer lines
+            if (first == pieceEnd || base[first] == '#' || isdigit((unsigned char)base[s]))
+            {
+                s = pieceEnd;
+                continue;
+            }
+            size_t h = scan_next(hash, s, pieceEnd);
+            long cut = h < pieceEnd ? (long)(h - s) - 1 : (long)(pieceEnd - s) - 1;
+            long w = cut > 0 ? (long)(scan_next(ws, s, s + cut) - s) : 0;
+            if (w == 0 || w >= cut - 1)
+            {
+                return false;
+            }
+            cb(ctx, base + s, (int)w, base + s + w + 1, (int)(cut - w - 1));
+            s = pieceEnd;
+        }
+        base += s;
+    }
+    return true;
+}
+
+/**
+ * carry_append() - Append bytes to a carried partial line.
+ * @c: Partial line, zero-initialized before the first call.
+ * @s: Bytes to append.
+ * @len: Number of bytes, may be 0.
+ *
+ * Returns: Nothing.
+ */
+void carry_append(carry *c, const char *s, size_t len){
+    if (c->len + len > c->cap)
+    {
+        while (c->len + len > c->cap)
+        {
+            c->cap = c->cap ? 2 * c->cap : 4096;
+        }
+        c->buf = check(alloc_realloc(ALLOC_LOADER, c->buf, c->cap));
+    }
+    if (len > 0)
+    {
+        memcpy(c->buf + c->len, s, len);
+        c->len += len;
+    }
+}
+
+/**
+ * map_scan_source() - Find the edges of a whole map read from a source.
+ * @src: Source of the map bytes. Not closed.
+ * @blockSize: Number of bytes to read at a time.
+ * @cb: Function called with the two city names of each edge.
+ * @ctx: Passed on to cb.
+ *
+ * Lines split between two reads are joined first, so the edges are the
+ * same as map_scan_lines() finds in the whole map at once. Prints an
+ * error message for a badly formatted map.
+ *
+ * Returns: True if the map was read and well formed, otherwise false.
+ */
+bool map_scan_source(source *src, size_t blockSize, edge_callback cb, void *ctx){
+    char *block = check(alloc_malloc(ALLOC_LOADER, blockSize));
+    carry c = { NULL, 0, 0 };
+    bool ok = true;
+    ssize_t n = 0;
+    while (ok && (n = source_read(src, block, blockSize)) != 0)
+    {
+        if (n < 0)
+        {
+            ok = false;
+            break;
+        }
+        // Parse the complete lines, keep the unfinished last line
+        const char *p = block;
+        const char *end = block + n;
+        const char *last = end;
+        while (last > p && last[-1] != '\n')
+        {
+            last--;
+        }
+        if (c.len > 0 && last > p)
+        {
+            const char *first = memchr(p, '\n', n);
+            carry_append(&c, p, first + 1 - p);
+            ok = map_scan_lines(c.buf, c.buf + c.len, cb, ctx);
+            c.len = 0;
+            p = first + 1;
+        }
+        ok = ok && map_scan_lines(p, last, cb, ctx);
+        carry_append(&c, last, end - last);
+    }
+    // A last line without a newline
+    if (ok && !map_scan_lines(c.buf, c.buf + c.len, cb, ctx))
+    {
+        ok = false;
+    }
+    if (!ok && n >= 0)
+    {
+        fprintf(stderr, "ERROR: Bad file format!\n");
+    }
+    alloc_free(block);
+    alloc_free(c.buf);
+    return ok;
+}
+
+/**
+ * map_is_undirected() - Check if a map says that its routes run both ways.
+ * @src: Source of the map, not read from yet.
+ *
+ * An undirected map has "# undirected" as its first line, with any
+ * white-space around the word. The line is peeked at, so piped and
+ * compressed maps are recognized too and are still read from the start.
+ *
+ * Returns: True if the map is marked as undirected, otherwise false.
+ */
+bool map_is_undirected(source *src){
+    char line[BUFSIZE];
+    ssize_t n = source_peek(src, line, BUFSIZE - 1);
+    if (n <= 0)
+    {
+        return false;
+    }
+    // Only the first line counts, as fgets() would have read it
+    char *nl = memchr(line, '\n', n);
+    line[nl != NULL ? nl - line : n] = '\0';
+    char word[BUFSIZE];
+    char rest;
+    return sscanf(line, " # %s %c", word, &rest) == 1 && !strcmp(word, "undirected");
+}
+
+/* Append an edge of local ids to a chunk. */
+static void push_edge(chunk *c, int src, int dst)
+{
+    if (c->numEdges == c->capEdges) {
+        c->capEdges = c->capEdges ? 2 * c->capEdges : 1024;
+        c->src = check(alloc_realloc(ALLOC_LOADER, c->src, c->capEdges * sizeof(int)));
+        c->dst = check(alloc_realloc(ALLOC_LOADER, c->dst, c->capEdges * sizeof(int)));
+    }
+    c->src[c->numEdges] = src;
+    c->dst[c->numEdges] = dst;
+    c->numEdges++;
+}
+
+/* Edge callback: intern both names in the chunk's own table. */
+static void chunk_edge(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    chunk *c = ctx;
+    int src = strtab_intern(c->names, a, alen, NULL);
+    int dst = strtab_intern(c->names, b, blen, NULL);
+    push_edge(c, src, dst);
+}
+
+/* Thread body: tokenize a chunk into local names and edges. */
+static void *tokenize(void *arg)
+{
+    chunk *c = arg;
+    c->names = strtab_empty(0);
+    c->bad = !map_scan_lines(c->begin, c->end, chunk_edge, c);
+    return NULL;
+}
+
+/* Thread body: rewrite edges to global ids and count them per range. */
+static void *count_ranges(void *arg)
+{
+    chunk *c = arg;
+    for (int i = 0; i < c->numEdges; i++) {
+        c->src[i] = c->map[c->src[i]];
+        c->dst[i] = c->map[c->dst[i]];
+        c->buckets[c->src[i] / c->width]++;
+    }
+    return NULL;
+}
+
+/* Thread body: move the edges to their range's part of the pairs. */
+static void *bucket_edges(void *arg)
+{
+    chunk *c = arg;
+    for (int i = 0; i < c->numEdges; i++) {
+        int at = c->buckets[c->src[i] / c->width]++;
+        c->pairs[2 * at] = c->src[i];
+        c->pairs[2 * at + 1] = c->dst[i];
+    }
+    alloc_free(c->src);
+    alloc_free(c->dst);
+    c->src = NULL;
+    c->dst = NULL;
+    return NULL;
+}
+
+/* Thread body: counting sort of a range's pairs on source id. */
+static void *sort_range(void *arg)
+{
+    range *r = arg;
+    int *start = r->start;
+    for (int k = r->begin; k < r->end; k++) {
+        start[r->pairs[2 * k]]++;
+    }
+    int at = r->begin;
+    for (int s = r->lo; s < r->hi; s++) {
+        int count = start[s];
+        start[s] = at;
+        at += count;
+    }
+    // Each offset moves to the end of its source, which is stable
+    for (int k = r->begin; k < r->end; k++) {
+        r->sorted[start[r->pairs[2 * k]]++] = r->pairs[2 * k + 1];
+    }
+    for (int s = r->hi - 1; s > r->lo; s--) {
+        start[s] = start[s - 1];
+    }
+    if (r->hi > r->lo) {
+        start[r->lo] = r->begin;
+    }
+    return NULL;
+}
+
+/* Run a thread body on n items of the given size, one thread each. */
+static void run_parallel(void *items, size_t size, int n, void *(*body)(void *))
+{
+    pthread_t tid[MAX_THREADS];
+    char *item = items;
+    for (int i = 1; i < n; i++) {
+        if (pthread_create(&tid[i], NULL, body, item + i * size)) {
+            // Could not start a thread, do its share here instead
+            tid[i] = pthread_self();
+            body(item + i * size);
+        }
+    }
+    body(item);
+    for (int i = 1; i < n; i++) {
+        if (!pthread_equal(tid[i], pthread_self())) {
+            pthread_join(tid[i], NULL);
+        }
+    }
+}
+
+/* Map the whole file, or read it into memory if it can not be mapped. */
+static char *map_file(FILE *in, size_t *size, bool *mapped)
+{
+    struct stat st;
+    int fd = fileno(in);
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            posix_madvise(p, st.st_size, POSIX_MADV_SEQUENTIAL);
+            // Leave the file position after the loaded bytes, as reading would
+            lseek(fd, st.st_size, SEEK_SET);
+            *size = st.st_size;
+            *mapped = true;
+            return p;
+        }
+    }
+    size_t cap = 1 << 16;
+    size_t n = 0;
+    size_t got;
+    char *buf = check(alloc_malloc(ALLOC_LOADER, cap));
+    while ((got = fread(buf + n, 1, cap - n, in)) > 0) {
+        n += got;
+        if (n == cap) {
+            cap *= 2;
+            buf = check(alloc_realloc(ALLOC_LOADER, buf, cap));
+        }
+    }
+    *size = n;
+    *mapped = false;
+    return buf;
+}
+
+/* Release what map_file() returned. */
+static void unmap_file(char *data, size_t size, bool mapped)
+{
+    if (mapped) {
+        munmap(data, size);
+    } else {
+        alloc_free(data);
+    }
+}
+
+/* Return the node of a city, adding it if the name is new. */
+static node *builder_node(builder *b, const char *s, int len)
+{
+    bool added;
+    int index = strtab_intern(b->names, s, len, &added);
+    if (added) {
+        graph_insert_node(b->g, strtab_name(b->names, index));
+    }
+    return graph_get_node(b->g, index);
+}
+
+/* Edge callback: insert the edge, adding its cities as needed. */
+static void build_edge(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    builder *bd = ctx;
+    node *from = builder_node(bd, a, alen);
+    graph_insert_edge(bd->g, from, builder_node(bd, b, blen));
+    bd->numEdges++;
+}
+
+/**
+ * load_map_sequential() - Build a graph from a map on the calling thread.
+ * @src: Source of the map bytes. Not closed.
+ * @cities: Empty list that receives the city names in node order.
+ * @numCities: Set to the number of cities, i.e. nodes.
+ * @numEdges: Set to the number of edges inserted.
+ *
+ * The map is read a block at a time and split by map_scan_source(). A
+ * city gets its node the first time it is seen. The names in cities
+ * are owned by the caller and must be alloc_free()-d after the graph
+ * is killed.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted.
+ */
+graph *load_map_sequential(source *src, list *cities, int *numCities, int *numEdges){
+    builder b = { graph_empty(0), strtab_empty(0), 0 };
+    TRACE_BEGIN("read_file");
+    bool ok = map_scan_source(src, READ_SIZE, build_edge, &b);
+    TRACE_END("read_file");
+    if (!ok)
+    {
+        graph_kill(b.g);
+        strtab_kill(b.names, true);
+        return NULL;
+    }
+    *numCities = strtab_size(b.names);
+    *numEdges = b.numEdges;
+    for (int i = 0; i < *numCities; i++)
+    {
+        list_insert(cities, (char *)strtab_name(b.names, i), list_end(cities));
+    }
+    strtab_kill(b.names, false);
+    return b.g;
+}
+
+/**
+ * load_map_parallel() - Build a graph from a map file using threads.
+ * @in: Map file opened for reading.
+ * @threads: Number of threads to use, or 0 for one per core.
+ * @cities: Empty list that receives the city names in node order.
+ * @numCities: Set to the number of cities, i.e. nodes.
+ * @numEdges: Set to the number of edges inserted.
+ *
+ * The names in cities are owned by the caller and must be
+ * alloc_free()-d after the graph is killed.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted.
+ */
+graph *load_map_parallel(FILE *in, int threads, list *cities, int *numCities,
+                         int *numEdges){
+    size_t size;
+    bool mapped;
+
+    if (threads <= 0)
+    {
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (threads < 1)
+    {
+        threads = 1;
+    }
+    if (threads > MAX_THREADS)
+    {
+        threads = MAX_THREADS;
+    }
+
+    TRACE_BEGIN("read_file");
+    char *data = map_file(in, &size, &mapped);
+    TRACE_END("read_file");
+
+    // Cut the file in equal parts, moving each cut past the next newline
+    chunk *chunks = check(alloc_calloc(ALLOC_LOADER, threads, sizeof(chunk)));
+    const char *pos = data;
+    for (int i = 0; i < threads; i++)
+    {
+        chunks[i].begin = pos;
+        const char *end = data + size * (i + 1) / threads;
+        if (end < pos)
+        {
+            end = pos;
+        }
+        if (i == threads - 1)
+        {
+            end = data + size;
+        }
+        else if (end > data && end < data + size && end[-1] != '\n')
+        {
+            const char *nl = memchr(end, '\n', data + size - end);
+            end = nl != NULL ? nl + 1 : data + size;
+        }
+        chunks[i].end = end;
+        pos = end;
+    }
+
+    TRACE_BEGIN("tokenize");
+    run_parallel(chunks, sizeof(chunk), threads, tokenize);
+    TRACE_END("tokenize");
+    for (int i = 0; i < threads; i++)
+    {
+        if (chunks[i].bad)
+        {
+            fprintf(stderr, "ERROR: Bad file format!\n");
+            for (int k = 0; k < threads; k++)
+            {
+                strtab_kill(chunks[k].names, true);
+                alloc_free(chunks[k].src);
+                alloc_free(chunks[k].dst);
+            }
+            alloc_free(chunks);
+            unmap_file(data, size, mapped);
+            return NULL;
+        }
+    }
+
+    // Merge the name tables in file order, which gives every name the
+    // index of its first occurrence in the whole file. The first chunk's
+    // table already is that order, the others are added to it.
+    TRACE_BEGIN("unique_cities");
+    strtab *names = chunks[0].names;
+    for (int i = 0; i < threads; i++)
+    {
+        int local = strtab_size(chunks[i].names);
+        chunks[i].map = check(alloc_malloc(ALLOC_LOADER, (local + 1) * sizeof(int)));
+        for (int id = 0; id < local; id++)
+        {
+            if (i == 0)
+            {
+                chunks[i].map[id] = id;
+                continue;
+            }
+            const char *name = strtab_name(chunks[i].names, id);
+            chunks[i].map[id] = strtab_intern(names, name, strlen(name), NULL);
+        }
+        if (i > 0)
+        {
+            strtab_kill(chunks[i].names, true);
+        }
+    }
+    TRACE_END("unique_cities");
+    int n = strtab_size(names);
+
+    // Sort the edges on source id in two passes. Each chunk first moves
+    // its edges to one bucket per range of source ids, then each range
+    // sorts its own edges. Offsets are taken in chunk order and the
+    // sorts are stable, so each source keeps its edges in file order.
+    TRACE_BEGIN("count_sort");
+    int width = n > threads ? (n + threads - 1) / threads : 1;
+    for (int i = 0; i < threads; i++)
+    {
+        chunks[i].buckets = check(alloc_calloc(ALLOC_LOADER, threads + 1, sizeof(int)));
+        chunks[i].width = width;
+    }
+    run_parallel(chunks, sizeof(chunk), threads, count_ranges);
+    range *ranges = check(alloc_calloc(ALLOC_LOADER, threads, sizeof(range)));
+    int total = 0;
+    for (int r = 0; r < threads; r++)
+    {
+        ranges[r].begin = total;
+        for (int i = 0; i < threads; i++)
+        {
+            int count = chunks[i].buckets[r];
+            chunks[i].buckets[r] = total;
+            total += count;
+        }
+        ranges[r].end = total;
+    }
+    int *pairs = check(alloc_malloc(ALLOC_LOADER, (2 * (size_t)total + 1) * sizeof(int)));
+    for (int i = 0; i < threads; i++)
+    {
+        chunks[i].pairs = pairs;
+    }
+    run_parallel(chunks, sizeof(chunk), threads, bucket_edges);
+
+    int *start = check(alloc_calloc(ALLOC_LOADER, n + 1, sizeof(int)));
+    int *sorted = check(alloc_malloc(ALLOC_LOADER, (total + 1) * sizeof(int)));
+    for (int r = 0; r < threads; r++)
+    {
+        long long lo = (long long)r * width;
+        ranges[r].lo = lo < n ? (int)lo : n;
+        ranges[r].hi = lo + width < n ? (int)(lo + width) : n;
+        ranges[r].pairs = pairs;
+        ranges[r].start = start;
+        ranges[r].sorted = sorted;
+    }
+    run_parallel(ranges, sizeof(range), threads, sort_range);
+    start[n] = total;
+    alloc_free(pairs);
+    alloc_free(ranges);
+    TRACE_END("count_sort");
+
+    TRACE_BEGIN("add_nodes");
+    graph *g = graph_empty(n);
+    for (int s = 0; s < n; s++)
+    {
+        char *name = (char *)strtab_name(names, s);
+        graph_insert_node(g, name);
+        list_insert(cities, name, list_end(cities));
+    }
+    TRACE_END("add_nodes");
+
+    TRACE_BEGIN("add_neighbours");
+    for (int s = 0; s < n; s++)
+    {
+        node *from = graph_get_node(g, s);
+        for (int k = start[s]; k < start[s + 1]; k++)
+        {
+            graph_insert_edge(g, from, graph_get_node(g, sorted[k]));
+        }
+    }
+    TRACE_END("add_neighbours");
+    *numCities = n;
+    *numEdges = total;
+
+    // The names now belong to the graph and the cities list
+    strtab_kill(names, false);
+    for (int i = 0; i < threads; i++)
+    {
+        alloc_free(chunks[i].src);
+        alloc_free(chunks[i].dst);
+        alloc_free(chunks[i].map);
+        alloc_free(chunks[i].buckets);
+    }
+    alloc_free(chunks);
+    alloc_free(start);
+    alloc_free(sorted);
+    unmap_file(data, size, mapped);
+    return g;
+}
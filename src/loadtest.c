@@ -0,0 +1,262 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "alloc.h"
+#include "stats.h"
+#include "histogram.h"
+#include "server.h"
+
+/*
+ * Load generator for the query server. Opens a number of connections,
+ * each on its own thread, and keeps up to a given number of requests
+ * in flight on each. Reports throughput and the latency percentiles
+ * seen by the clients.
+ *
+ * The queries are taken from a file with one "origin destination" pair
+ * per line. Blank lines, comments and lines starting with a digit are
+ * skipped, so a map file can be used directly.
+ */
+
+#define MAX_CONNECTIONS 1024
+#define MAX_DEPTH 1024
+
+typedef struct client {
+    const char *path;
+    char **queries;      // Request lines, each ending in '\n'.
+    int numQueries;
+    unsigned long requests;
+    int depth;
+    unsigned seed;
+    unsigned long answered;
+    unsigned long errors;
+    histogram *latency;
+    pthread_t thread;
+} client;
+
+/* Connect to the server socket, or return -1. */
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Write a whole buffer, or return false. */
+static bool write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= n;
+    }
+    return true;
+}
+
+/* Connection thread: send requests, keeping depth of them in flight. */
+static void *run_client(void *arg)
+{
+    client *cl = arg;
+    int fd = connect_to(cl->path);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to connect to %s: %s\n", cl->path, strerror(errno));
+        cl->errors = cl->requests;
+        return NULL;
+    }
+    double *sent = check(alloc_malloc(ALLOC_STATS, cl->depth * sizeof(double)));
+    char *out = check(alloc_malloc(ALLOC_STATS, (size_t)cl->depth * SERVER_LINE_MAX));
+    char in[8192];
+    size_t inLen = 0;
+    unsigned long issued = 0;
+
+    while (cl->answered < cl->requests) {
+        // Top up the requests in flight with one write
+        double now = stats_now();
+        size_t outLen = 0;
+        while (issued < cl->requests && issued - cl->answered < (unsigned long)cl->depth) {
+            const char *q = cl->queries[rand_r(&cl->seed) % cl->numQueries];
+            size_t len = strlen(q);
+            memcpy(out + outLen, q, len);
+            outLen += len;
+            sent[issued % cl->depth] = now;
+            issued++;
+        }
+        if (outLen > 0 && !write_all(fd, out, outLen)) {
+            break;
+        }
+
+        // Take the answers that have arrived
+        ssize_t n = read(fd, in + inLen, sizeof(in) - inLen);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        inLen += n;
+        now = stats_now();
+        char *p = in;
+        char *nl;
+        while ((nl = memchr(p, '\n', in + inLen - p)) != NULL) {
+            double stamp = sent[cl->answered % cl->depth];
+            histogram_record(cl->latency, (uint64_t)((now - stamp) * 1e9));
+            if (!strncmp(p, "ERR", 3)) {
+                cl->errors++;
+            }
+            cl->answered++;
+            p = nl + 1;
+        }
+        inLen = in + inLen - p;
+        memmove(in, p, inLen);
+    }
+    // Requests that never got an answer
+    cl->errors += cl->requests - cl->answered;
+    alloc_free(out);
+    alloc_free(sent);
+    close(fd);
+    return NULL;
+}
+
+/* Read the query pairs from a file. Returns the number read, or -1. */
+static int read_queries(const char *file, char ***queries)
+{
+    FILE *in = fopen(file, "r");
+    if (in == NULL) {
+        fprintf(stderr, "Failed to open %s for reading: %s\n", file, strerror(errno));
+        return -1;
+    }
+    char line[SERVER_LINE_MAX];
+    char a[SERVER_LINE_MAX];
+    char b[SERVER_LINE_MAX];
+    int count = 0;
+    int cap = 0;
+    *queries = NULL;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char *hash = strchr(line, '#');
+        if (hash != NULL) {
+            *hash = '\0';
+        }
+        if (isdigit((unsigned char)line[0]) || sscanf(line, "%s %s", a, b) != 2) {
+            continue;
+        }
+        if (count == cap) {
+            cap = cap ? 2 * cap : 1024;
+            *queries = check(alloc_realloc(ALLOC_STATS, *queries, cap * sizeof(char *)));
+        }
+        char *q = check(alloc_malloc(ALLOC_STATS, strlen(a) + strlen(b) + 3));
+        sprintf(q, "%s %s\n", a, b);
+        (*queries)[count++] = q;
+    }
+    fclose(in);
+    return count;
+}
+
+int main(int argc, const char **argv)
+{
+    int connections = 4;
+    unsigned long requests = 100000;
+    int depth = 1;
+    const char *path = NULL;
+    const char *file = NULL;
+    bool badArgs = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--connections") && i + 1 < argc) {
+            connections = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--requests") && i + 1 < argc) {
+            requests = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else if (file == NULL && argv[i][0] != '-') {
+            file = argv[i];
+        } else {
+            badArgs = true;
+        }
+    }
+    if (file == NULL || badArgs || connections < 1 || connections > MAX_CONNECTIONS ||
+        depth < 1 || depth > MAX_DEPTH) {
+        fprintf(stderr, "Usage: ./loadtest [--connections n] [--requests n] [--depth n]"
+                        " socket queries\n");
+        return -1;
+    }
+
+    char **queries;
+    int numQueries = read_queries(file, &queries);
+    if (numQueries <= 0) {
+        if (numQueries == 0) {
+            fprintf(stderr, "No queries in %s\n", file);
+        }
+        return -1;
+    }
+
+    client *clients = check(alloc_calloc(ALLOC_STATS, connections, sizeof(client)));
+    double start = stats_now();
+    for (int i = 0; i < connections; i++) {
+        client *cl = &clients[i];
+        cl->path = path;
+        cl->queries = queries;
+        cl->numQueries = numQueries;
+        // Spread the requests, the first clients take the remainder
+        cl->requests = requests / connections + ((unsigned long)i < requests % connections);
+        cl->depth = depth;
+        cl->seed = i + 1;
+        cl->latency = histogram_empty();
+        if (pthread_create(&cl->thread, NULL, run_client, cl)) {
+            fprintf(stderr, "Failed to start client threads\n");
+            return -1;
+        }
+    }
+
+    unsigned long answered = 0;
+    unsigned long errors = 0;
+    histogram *latency = histogram_empty();
+    for (int i = 0; i < connections; i++) {
+        pthread_join(clients[i].thread, NULL);
+        answered += clients[i].answered;
+        errors += clients[i].errors;
+        histogram_merge(latency, clients[i].latency);
+        alloc_free(clients[i].latency);
+    }
+    double elapsed = stats_now() - start;
+
+    printf("loadtest: connections=%d depth=%d requests=%lu errors=%lu time=%.6fs throughput=%.1f/s\n",
+           connections, depth, answered, errors, elapsed, elapsed > 0 ? answered / elapsed : 0.0);
+    histogram_report(stdout, "latency", latency);
+
+    alloc_free(latency);
+    alloc_free(clients);
+    for (int i = 0; i < numQueries; i++) {
+        alloc_free(queries[i]);
+    }
+    alloc_free(queries);
+    return errors == 0 ? 0 : 1;
+}
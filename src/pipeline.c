@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "alloc.h"
+#include "list.h"
+#include "graph.h"
+#include "strtab.h"
+#include "ring.h"
+#include "trace.h"
+#include "loader.h"
+#include "source.h"
+#include "pipeline.h"
+
+/*
+ * Implementation of the pipelined map loader.
+ */
+
+// Bytes asked for in each source_read().
+#define BLOCK_SIZE (1 << 20)
+// Edges handed from the parser to the builder at a time.
+#define BATCH_SIZE 4096
+// Slots in each ring. Bounds the memory in flight between two stages.
+#define RING_SLOTS 8
+
+// A block of raw input. A block with len 0 marks the end of the file.
+typedef struct block {
+    size_t len;
+    char data[];
+} block;
+
+// A batch of edges as pairs of name ids, with the names first seen in
+// the batch in id order. NULL marks the end.
+typedef struct batch {
+    int count;
+    int numNames;
+    int pairs[2 * BATCH_SIZE];
+    char *names[2 * BATCH_SIZE];
+} batch;
+
+typedef struct reader_state {
+    source *src;
+    ring *out;
+    bool failed;       // The source could not be read to the end.
+} reader_state;
+
+typedef struct parser_state {
+    ring *in;
+    ring *out;
+    strtab *names;
+    batch *current;
+    carry carry;       // Start of a line split between two blocks.
+    bool bad;          // A badly formatted line was found.
+} parser_state;
+
+/* Reader stage: move the (decompressed) input, block by block, into the ring. */
+static void *reader(void *arg)
+{
+    reader_state *rs = arg;
+    for (;;) {
+        block *b = check(alloc_malloc(ALLOC_LOADER, sizeof(block) + BLOCK_SIZE));
+        // Decompression, if any, also happens here, off the parser thread
+        ssize_t n = source_read(rs->src, b->data, BLOCK_SIZE);
+        if (n < 0) {
+            // A partial graph would give wrong answers
+            rs->failed = true;
+            n = 0;
+        }
+        b->len = n;
+        ring_push(rs->out, b);
+        if (n == 0) {
+            return NULL;
+        }
+    }
+}
+
+/* Intern a name. A new name is also handed to the builder. */
+static int parser_name(parser_state *ps, const char *s, int len)
+{
+    bool added;
+    int id = strtab_intern(ps->names, s, len, &added);
+    if (added) {
+        // The interned copy stays put until the table is killed
+        batch *out = ps->current;
+        out->names[out->numNames++] = (char *)strtab_name(ps->names, id);
+    }
+    return id;
+}
+
+/* Start a new, empty batch. */
+static void parser_batch(parser_state *ps)
+{
+    ps->current = check(alloc_malloc(ALLOC_LOADER, sizeof(batch)));
+    ps->current->count = 0;
+    ps->current->numNames = 0;
+}
+
+/* Edge callback: intern the names and add the edge to the batch. */
+static void parser_edge(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    parser_state *ps = ctx;
+    batch *out = ps->current;
+    out->pairs[2 * out->count] = parser_name(ps, a, alen);
+    out->pairs[2 * out->count + 1] = parser_name(ps, b, blen);
+    out->count++;
+    if (out->count == BATCH_SIZE) {
+        ring_push(ps->out, out);
+        parser_batch(ps);
+    }
+}
+
+/* Parse a range of complete lines. After a bad line nothing is parsed. */
+static void parse_lines(parser_state *ps, const char *begin, const char *end)
+{
+    if (!ps->bad && !map_scan_lines(begin, end, parser_edge, ps)) {
+        fprintf(stderr, "ERROR: Bad file format!\n");
+        // Keep taking blocks so that the reader can finish
+        ps->bad = true;
+    }
+}
+
+/* Parser stage: turn blocks into batches of interned edges. */
+static void *parser(void *arg)
+{
+    parser_state *ps = arg;
+    parser_batch(ps);
+    for (;;) {
+        block *b = ring_pop(ps->in);
+        if (b->len == 0) {
+            alloc_free(b);
+            break;
+        }
+        const char *p = b->data;
+        const char *end = b->data + b->len;
+        const char *first = memchr(p, '\n', b->len);
+        if (first == NULL) {
+            // No line ends in this block
+            carry_append(&ps->carry, p, b->len);
+            alloc_free(b);
+            continue;
+        }
+        // Finish the line started in earlier blocks
+        if (ps->carry.len > 0) {
+            carry_append(&ps->carry, p, first + 1 - p);
+            parse_lines(ps, ps->carry.buf, ps->carry.buf + ps->carry.len);
+            ps->carry.len = 0;
+            p = first + 1;
+        }
+        // Parse the complete lines, keep the unfinished last line
+        const char *last = end;
+        while (last > p && last[-1] != '\n') {
+            last--;
+        }
+        parse_lines(ps, p, last);
+        carry_append(&ps->carry, last, end - last);
+        alloc_free(b);
+    }
+    // A last line without a newline
+    parse_lines(ps, ps->carry.buf, ps->carry.buf + ps->carry.len);
+    if (ps->current->count > 0) {
+        ring_push(ps->out, ps->current);
+    } else {
+        alloc_free(ps->current);
+    }
+    ring_push(ps->out, NULL);
+    alloc_free(ps->carry.buf);
+    return NULL;
+}
+
+/**
+ * load_map_pipelined() - Build a graph from a stream of map lines.
+ * @src: Source of the map bytes. Not closed.
+ * @cities: Empty list that receives the city names in node order.
+ * @numCities: Set to the number of cities, i.e. nodes.
+ * @numEdges: Set to the number of edges inserted.
+ *
+ * The graph is built while the file is still being read. Nodes are
+ * inserted as their names turn up and the graph grows as needed, so
+ * neither the number of cities nor the edges have to be known first.
+ *
+ * The names in cities are owned by the caller and must be
+ * alloc_free()-d after the graph is killed.
+ *
+ * Returns: A pointer to the new graph, or NULL after printing an error
+ * message if the map is badly formatted or could not be read.
+ */
+graph *load_map_pipelined(source *src, list *cities, int *numCities, int *numEdges){
+    reader_state rs;
+    parser_state ps;
+    pthread_t readerThread, parserThread;
+
+    memset(&rs, 0, sizeof(rs));
+    memset(&ps, 0, sizeof(ps));
+    rs.src = src;
+    rs.out = ring_empty(RING_SLOTS);
+    ps.in = rs.out;
+    ps.out = ring_empty(RING_SLOTS);
+    ps.names = strtab_empty(0);
+
+    TRACE_BEGIN("read_file");
+    if (pthread_create(&readerThread, NULL, reader, &rs) ||
+        pthread_create(&parserThread, NULL, parser, &ps))
+    {
+        fprintf(stderr, "Failed to start loader threads\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Builder stage, run by the calling thread. A batch holds the names
+    // it uses for the first time, in id order, so node i is name id i.
+    graph *g = graph_empty(0);
+    int count = 0;
+    batch *b;
+    while ((b = ring_pop(ps.out)) != NULL)
+    {
+        for (int s = 0; s < b->numNames; s++)
+        {
+            graph_insert_node(g, b->names[s]);
+        }
+        for (int i = 0; i < b->count; i++)
+        {
+            graph_insert_edge(g, graph_get_node(g, b->pairs[2 * i]),
+                              graph_get_node(g, b->pairs[2 * i + 1]));
+        }
+        count += b->count;
+        alloc_free(b);
+    }
+    pthread_join(readerThread, NULL);
+    pthread_join(parserThread, NULL);
+    ring_kill(rs.out);
+    ring_kill(ps.out);
+    TRACE_END("read_file");
+    if (rs.failed || ps.bad)
+    {
+        graph_kill(g);
+        strtab_kill(ps.names, true);
+        return NULL;
+    }
+
+    int n = strtab_size(ps.names);
+    for (int s = 0; s < n; s++)
+    {
+        list_insert(cities, (char *)strtab_name(ps.names, s), list_end(cities));
+    }
+    strtab_kill(ps.names, false);
+
+    *numCities = n;
+    *numEdges = count;
+    return g;
+}
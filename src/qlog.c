@@ -0,0 +1,127 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include "alloc.h"
+#include "stats.h"
+#include "qlog.h"
+
+/*
+ * Implementation of query log capture and replay.
+ */
+
+#define QLOG_HEADER "# query-log v1 start=%ld\n"
+
+struct qlog {
+    FILE *out;
+    double start;  // Monotonic time of the first line.
+};
+
+/**
+ * qlog_create() - Start a new query log.
+ * @file: Name of the log file to create.
+ *
+ * Returns: A pointer to the new log, or NULL if the file could not be
+ * created.
+ */
+qlog *qlog_create(const char *file){
+    FILE *out = fopen(file, "w");
+    if (out == NULL)
+    {
+        return NULL;
+    }
+    qlog *log = check(alloc_calloc(ALLOC_STATS, 1, sizeof(*log)));
+    log->out = out;
+    log->start = stats_now();
+    fprintf(out, QLOG_HEADER, (long)time(NULL));
+    return log;
+}
+
+/**
+ * qlog_record() - Append one query to the log.
+ * @log: Log to append to.
+ * @origin: Origin city.
+ * @dest: Destination city.
+ * @result: 1, 0 or -1 as described above.
+ *
+ * Returns: Nothing.
+ */
+void qlog_record(qlog *log, const char *origin, const char *dest, int result){
+    uint64_t us = (uint64_t)((stats_now() - log->start) * 1e6);
+    fprintf(log->out, "%" PRIu64 " %s %s %d\n", us, origin, dest, result);
+}
+
+/**
+ * qlog_kill() - Flush and close a query log.
+ * @log: Log to close.
+ *
+ * Returns: Nothing.
+ */
+void qlog_kill(qlog *log){
+    fclose(log->out);
+    alloc_free(log);
+}
+
+/* Sleep until the monotonic clock reaches the given time. */
+static void wait_until(double when)
+{
+    double left = when - stats_now();
+    if (left > 0) {
+        struct timespec ts;
+        ts.tv_sec = (time_t)left;
+        ts.tv_nsec = (long)((left - ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    }
+}
+
+/**
+ * qlog_replay() - Re-run every query of a captured log.
+ * @in: Log to read.
+ * @paced: If true, wait so that queries start at their recorded times.
+ * @answer: Function answering a query.
+ * @ctx: Passed on to answer.
+ * @latency: Histogram receiving the time of each query in ns.
+ * @res: Filled in with the outcome of the replay.
+ *
+ * Mismatching answers are reported on stderr.
+ *
+ * Returns: True if the log was well formed, otherwise false.
+ */
+bool qlog_replay(FILE *in, bool paced, query_function answer, void *ctx,
+                 histogram *latency, replay_result *res){
+    char origin[QLOG_NAME_MAX + 1];
+    char dest[QLOG_NAME_MAX + 1];
+    uint64_t us;
+    int expected;
+    long started;
+    int fields;
+
+    memset(res, 0, sizeof(*res));
+    if (fscanf(in, "# query-log v1 start=%ld", &started) != 1)
+    {
+        return false;
+    }
+    double start = stats_now();
+    while ((fields = fscanf(in, "%" SCNu64 " %39s %39s %d", &us, origin, dest, &expected)) == 4)
+    {
+        if (paced)
+        {
+            wait_until(start + us / 1e6);
+        }
+        double before = stats_now();
+        int result = answer(ctx, origin, dest);
+        histogram_record(latency, (uint64_t)((stats_now() - before) * 1e9));
+        res->queries++;
+        if (result != expected)
+        {
+            res->mismatches++;
+            fprintf(stderr, "Mismatch at %" PRIu64 "us: %s %s gave %d, log says %d\n",
+                    us, origin, dest, result, expected);
+        }
+    }
+    res->elapsed = stats_now() - start;
+    return fields == EOF;
+}
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "alloc.h"
 #include "queue.h"
 #include "list.h"
 
@@ -40,7 +41,7 @@ struct queue {
 queue *queue_empty(free_function free_func)
 {
 	// Allocate the queue head.
-	queue *q=calloc(1, sizeof(*q));
+	queue *q=alloc_calloc(ALLOC_QUEUE, 1, sizeof(*q));
 	// Create an empty list.
 	q->elements=list_empty(free_func);
 
@@ -110,7 +111,7 @@ void *queue_front(const queue *q)
 void queue_kill(queue *q)
 {
 	list_kill(q->elements);
-	free(q);
+	alloc_free(q);
 }
 
 /**
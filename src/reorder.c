@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "bitset.h"
+#include "reorder.h"
+
+/*
+ * Implementation of the node orders.
+ *
+ * The orders are computed on an undirected copy of the edges in
+ * compressed rows, and applied with graph_renumber(). Nodes are sorted
+ * by degree as 64-bit keys with the degree in the high half and the
+ * node in the low half, so ties keep the old order.
+ */
+
+/* Order 64-bit keys ascending, for qsort(). */
+static int compare_key(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Node v's undirected neighbours are adj[first[v]..first[v+1]). */
+static int *undirected(const graph *g, int **adjOut)
+{
+    int n = graph_node_count(g);
+    int *first = check(alloc_calloc(ALLOC_GRAPH, n + 2, sizeof(int)));
+    for (int v = 0; v < n; v++) {
+        neighbour_iter it;
+        graph_id w;
+        graph_neighbours_begin(g, graph_get_node(g, v), &it);
+        while (graph_neighbours_next(g, &it, &w)) {
+            first[v + 2]++;
+            first[w + 2]++;
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        first[v + 2] += first[v + 1];
+    }
+    // first[v + 1] is now where v's row starts, and is used as the fill
+    // position until it reaches the start of the next row
+    int *adj = check(alloc_malloc(ALLOC_GRAPH, (first[n + 1] + 1) * sizeof(int)));
+    for (int v = 0; v < n; v++) {
+        neighbour_iter it;
+        graph_id w;
+        graph_neighbours_begin(g, graph_get_node(g, v), &it);
+        while (graph_neighbours_next(g, &it, &w)) {
+            adj[first[v + 1]++] = w;
+            adj[first[w + 1]++] = v;
+        }
+    }
+    *adjOut = adj;
+    return first;
+}
+
+/* Key sorting v by its degree, ascending or, if descending, the
+ * other way round. */
+static uint64_t degree_key(const int *first, int v, bool descending)
+{
+    uint32_t d = first[v + 1] - first[v];
+    return ((uint64_t)(descending ? ~d : d) << 32) | (uint32_t)v;
+}
+
+/* Fill order[] breadth first, starting from the nodes of starts[] in
+ * turn and, if byDegree, taking neighbours in order of degree. */
+static void breadth_first(const int *first, const int *adj, int n, const int *starts,
+                          bool byDegree, int *order)
+{
+    bitset *seen = bitset_empty();
+    bitset_clear(seen, n);
+    uint64_t *keys = NULL;
+    int keyCap = 0;
+    int k = 0;
+    for (int s = 0; s < n; s++) {
+        if (bitset_test_and_set(seen, starts[s])) {
+            continue;
+        }
+        int head = k;
+        order[k++] = starts[s];
+        while (head < k) {
+            int v = order[head++];
+            int from = k;
+            for (int e = first[v]; e < first[v + 1]; e++) {
+                if (!bitset_test_and_set(seen, adj[e])) {
+                    order[k++] = adj[e];
+                }
+            }
+            if (byDegree && k - from > 1) {
+                if (k - from > keyCap) {
+                    keyCap = k - from;
+                    keys = check(alloc_realloc(ALLOC_GRAPH, keys, keyCap * sizeof(*keys)));
+                }
+                for (int i = from; i < k; i++) {
+                    keys[i - from] = degree_key(first, order[i], false);
+                }
+                qsort(keys, k - from, sizeof(*keys), compare_key);
+                for (int i = from; i < k; i++) {
+                    order[i] = (int)(uint32_t)keys[i - from];
+                }
+            }
+        }
+    }
+    alloc_free(keys);
+    bitset_kill(seen);
+}
+
+/* Fill order[] with the nodes sorted by degree. */
+static void by_degree(const int *first, int n, bool descending, int *order)
+{
+    uint64_t *keys = check(alloc_malloc(ALLOC_GRAPH, (n + 1) * sizeof(*keys)));
+    for (int v = 0; v < n; v++) {
+        keys[v] = degree_key(first, v, descending);
+    }
+    qsort(keys, n, sizeof(*keys), compare_key);
+    for (int v = 0; v < n; v++) {
+        order[v] = (int)(uint32_t)keys[v];
+    }
+    alloc_free(keys);
+}
+
+/**
+ * reorder_parse() - Parse the name of an order.
+ * @s: "bfs", "rcm" or "degree".
+ * @order: Set to the order named by s.
+ *
+ * Returns: True if s names an order, otherwise false.
+ */
+bool reorder_parse(const char *s, graph_order *order){
+    for (graph_order o = ORDER_BFS; o <= ORDER_DEGREE; o++)
+    {
+        if (!strcmp(s, reorder_name(o)))
+        {
+            *order = o;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * reorder_name() - Return the name of an order.
+ * @order: Order to name.
+ *
+ * Returns: The name reorder_parse() takes, or "none".
+ */
+const char *reorder_name(graph_order order){
+    switch (order)
+    {
+    case ORDER_BFS: return "bfs";
+    case ORDER_RCM: return "rcm";
+    case ORDER_DEGREE: return "degree";
+    default: return "none";
+    }
+}
+
+/**
+ * reorder_bandwidth() - Measure how far apart the ends of edges lie.
+ * @g: Graph to inspect.
+ *
+ * Returns: The largest and the mean index distance over all edges, both
+ * 0 if there are no edges.
+ */
+bandwidth reorder_bandwidth(const graph *g){
+    bandwidth b = { 0, 0.0 };
+    double sum = 0;
+    unsigned long edges = 0;
+    for (int v = 0; v < graph_node_count(g); v++)
+    {
+        neighbour_iter it;
+        graph_id w;
+        graph_neighbours_begin(g, graph_get_node(g, v), &it);
+        while (graph_neighbours_next(g, &it, &w))
+        {
+            int d = (int)w > v ? (int)w - v : v - (int)w;
+            if (d > b.max)
+            {
+                b.max = d;
+            }
+            sum += d;
+            edges++;
+        }
+    }
+    if (edges > 0)
+    {
+        b.mean = sum / edges;
+    }
+    return b;
+}
+
+/**
+ * reorder_graph() - Renumber the nodes of a graph.
+ * @g: Graph to renumber. Must not be compact yet.
+ * @order: Order to number the nodes in.
+ *
+ * Returns: The modified graph.
+ */
+graph *reorder_graph(graph *g, graph_order order){
+    int n = graph_node_count(g);
+    if (order == ORDER_NONE || n == 0)
+    {
+        return g;
+    }
+    int *adj;
+    int *first = undirected(g, &adj);
+    int *seq = check(alloc_malloc(ALLOC_GRAPH, n * sizeof(int)));
+    int *starts = check(alloc_malloc(ALLOC_GRAPH, n * sizeof(int)));
+    switch (order)
+    {
+    case ORDER_BFS:
+        for (int v = 0; v < n; v++)
+        {
+            starts[v] = v;
+        }
+        breadth_first(first, adj, n, starts, false, seq);
+        break;
+    case ORDER_RCM:
+        // Each part is started from a node of lowest degree, which
+        // tends to lie on its rim
+        by_degree(first, n, false, starts);
+        breadth_first(first, adj, n, starts, true, seq);
+        for (int i = 0, j = n - 1; i < j; i++, j--)
+        {
+            int t = seq[i];
+            seq[i] = seq[j];
+            seq[j] = t;
+        }
+        break;
+    default:
+        by_degree(first, n, true, seq);
+        break;
+    }
+    // seq lists the old indices in their new order, invert it
+    int *newIndex = starts;
+    for (int i = 0; i < n; i++)
+    {
+        newIndex[seq[i]] = i;
+    }
+    graph_renumber(g, newIndex);
+    alloc_free(first);
+    alloc_free(adj);
+    alloc_free(seq);
+    alloc_free(newIndex);
+    return g;
+}
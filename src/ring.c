@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "alloc.h"
+#include "ring.h"
+
+/*
+ * Implementation of the single-producer/single-consumer ring buffer.
+ *
+ * The producer owns tail and the consumer owns head. Both only grow, and
+ * the slot of an index is index & mask. A waiting side spins briefly and
+ * then sleeps on a condition variable, so a stage starved by slow input
+ * does not burn a core. It counts itself in waiters first, and the other
+ * side only takes the lock to wake it when waiters is non-zero. A full
+ * fence between publishing an index and reading waiters, and between
+ * raising waiters and reading the index, makes sure that one of the two
+ * sees the other, so no wakeup is lost.
+ */
+
+#define CACHE_LINE 64
+// Number of failed attempts before a waiting side sleeps.
+#define SPINS 64
+
+struct ring {
+    size_t head;  // Next slot to pop, written by the consumer.
+    char pad1[CACHE_LINE - sizeof(size_t)];
+    size_t tail;  // Next slot to push, written by the producer.
+    char pad2[CACHE_LINE - sizeof(size_t)];
+    size_t mask;
+    void **slots;
+    int waiters;  // Sides sleeping on changed, at most one.
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+};
+
+/* Put a value in the ring if there is room, without waking anyone. */
+static bool put(ring *r, void *v)
+{
+    size_t tail = r->tail;
+    if (tail - __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) > r->mask) {
+        return false;
+    }
+    r->slots[tail & r->mask] = v;
+    __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Take the oldest value if there is one, without waking anyone. */
+static bool take(ring *r, void **v)
+{
+    size_t head = r->head;
+    if (head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *v = r->slots[head & r->mask];
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/* Wake the other side if it sleeps, after an index has been published. */
+static void wake(ring *r)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->waiters, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&r->lock);
+        pthread_cond_broadcast(&r->changed);
+        pthread_mutex_unlock(&r->lock);
+    }
+}
+
+/**
+ * ring_empty() - Create an empty ring.
+ * @capacity: Number of slots, rounded up to a power of two.
+ *
+ * Returns: A pointer to the new ring.
+ */
+ring *ring_empty(int capacity){
+    size_t size = 1;
+    while (size < (size_t)capacity)
+    {
+        size *= 2;
+    }
+    ring *r = alloc_calloc(ALLOC_QUEUE, 1, sizeof(*r));
+    if (r != NULL)
+    {
+        r->slots = alloc_calloc(ALLOC_QUEUE, size, sizeof(void *));
+    }
+    if (r == NULL || r->slots == NULL)
+    {
+        printf("Unable to allocate memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    r->mask = size - 1;
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->changed, NULL);
+    return r;
+}
+
+/**
+ * ring_try_push() - Put a value in the ring if there is room.
+ * @r: Ring to modify. Only called by the producer.
+ * @v: Value to put.
+ *
+ * Returns: True if the value was put, false if the ring was full.
+ */
+bool ring_try_push(ring *r, void *v){
+    if (!put(r, v))
+    {
+        return false;
+    }
+    wake(r);
+    return true;
+}
+
+/**
+ * ring_try_pop() - Take the oldest value from the ring if there is one.
+ * @r: Ring to modify. Only called by the consumer.
+ * @v: Set to the value taken.
+ *
+ * Returns: True if a value was taken, false if the ring was empty.
+ */
+bool ring_try_pop(ring *r, void **v){
+    if (!take(r, v))
+    {
+        return false;
+    }
+    wake(r);
+    return true;
+}
+
+/**
+ * ring_push() - Put a value in the ring, waiting while it is full.
+ * @r: Ring to modify. Only called by the producer.
+ * @v: Value to put.
+ *
+ * Returns: Nothing.
+ */
+void ring_push(ring *r, void *v){
+    for (int spins = 0; !put(r, v); spins++)
+    {
+        if (spins < SPINS)
+        {
+            continue;
+        }
+        pthread_mutex_lock(&r->lock);
+        __atomic_add_fetch(&r->waiters, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        while (!put(r, v))
+        {
+            pthread_cond_wait(&r->changed, &r->lock);
+        }
+        __atomic_sub_fetch(&r->waiters, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&r->lock);
+        break;
+    }
+    wake(r);
+}
+
+/**
+ * ring_pop() - Take the oldest value, waiting while the ring is empty.
+ * @r: Ring to modify. Only called by the consumer.
+ *
+ * Returns: The value taken.
+ */
+void *ring_pop(ring *r){
+    void *v;
+    for (int spins = 0; !take(r, &v); spins++)
+    {
+        if (spins < SPINS)
+        {
+            continue;
+        }
+        pthread_mutex_lock(&r->lock);
+        __atomic_add_fetch(&r->waiters, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        while (!take(r, &v))
+        {
+            pthread_cond_wait(&r->changed, &r->lock);
+        }
+        __atomic_sub_fetch(&r->waiters, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&r->lock);
+        break;
+    }
+    wake(r);
+    return v;
+}
+
+/**
+ * ring_kill() - Destroy a ring.
+ * @r: Ring to destroy. Values still in the ring are not freed.
+ *
+ * Returns: Nothing.
+ */
+void ring_kill(ring *r){
+    pthread_mutex_destroy(&r->lock);
+    pthread_cond_destroy(&r->changed);
+    alloc_free(r->slots);
+    alloc_free(r);
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "scan.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+/*
+ * Implementation of the byte classifier.
+ *
+ * Each 64-byte group is compared against '\n', '#', ' ' and the range
+ * '\t'..'\r' in vector registers, and the comparison results are packed
+ * into bits with movemask. Bytes of a last, partial group are handled
+ * one at a time.
+ */
+
+/* Classify up to 64 bytes one at a time. */
+static void classify_scalar(const char *s, size_t len, uint64_t *nl,
+                            uint64_t *ws, uint64_t *hash)
+{
+    uint64_t n = 0, w = 0, h = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = s[i];
+        uint64_t bit = (uint64_t)1 << i;
+        if (c == '\n') {
+            n |= bit;
+        }
+        if (c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t') {
+            w |= bit;
+        }
+        if (c == '#') {
+            h |= bit;
+        }
+    }
+    *nl = n;
+    *ws = w;
+    *hash = h;
+}
+
+#ifdef SCAN_X86
+
+/* Classify 64 bytes with SSE2, which every x86-64 processor has. */
+static void classify_sse2(const char *s, uint64_t *nl, uint64_t *ws, uint64_t *hash)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i pound = _mm_set1_epi8('#');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i span = _mm_set1_epi8('\r' - '\t');
+    uint64_t n = 0, w = 0, h = 0;
+    for (int k = 0; k < 4; k++) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + 16 * k));
+        // c - '\t' <= '\r' - '\t' as unsigned bytes
+        __m128i off = _mm_sub_epi8(v, tab);
+        __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(off, span), off);
+        __m128i white = _mm_or_si128(ctrl, _mm_cmpeq_epi8(v, space));
+        n |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << (16 * k);
+        w |= (uint64_t)(uint16_t)_mm_movemask_epi8(white) << (16 * k);
+        h |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, pound)) << (16 * k);
+    }
+    *nl = n;
+    *ws = w;
+    *hash = h;
+}
+
+/* Classify 64 bytes with AVX2. Only called if the processor has it. */
+__attribute__((target("avx2")))
+static void classify_avx2(const char *s, uint64_t *nl, uint64_t *ws, uint64_t *hash)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i pound = _mm256_set1_epi8('#');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i span = _mm256_set1_epi8('\r' - '\t');
+    uint64_t n = 0, w = 0, h = 0;
+    for (int k = 0; k < 2; k++) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + 32 * k));
+        __m256i off = _mm256_sub_epi8(v, tab);
+        __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(off, span), off);
+        __m256i white = _mm256_or_si256(ctrl, _mm256_cmpeq_epi8(v, space));
+        n |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)) << (32 * k);
+        w |= (uint64_t)(uint32_t)_mm256_movemask_epi8(white) << (32 * k);
+        h |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, pound)) << (32 * k);
+    }
+    *nl = n;
+    *ws = w;
+    *hash = h;
+}
+
+#endif
+
+/**
+ * scan_classify() - Classify every byte of a block.
+ * @s: Block to classify.
+ * @len: Length of the block.
+ * @nl: SCAN_WORDS(len) words receiving the newline bits.
+ * @ws: SCAN_WORDS(len) words receiving the white-space bits.
+ * @hash: SCAN_WORDS(len) words receiving the '#' bits.
+ *
+ * Bit i%64 of word i/64 describes byte i. Bits past len are cleared.
+ *
+ * Returns: Nothing.
+ */
+void scan_classify(const char *s, size_t len, uint64_t *nl, uint64_t *ws,
+                   uint64_t *hash){
+    size_t full = len / 64;
+    size_t i = 0;
+#ifdef SCAN_X86
+    static int hasAvx2 = -1;
+    int avx2 = __atomic_load_n(&hasAvx2, __ATOMIC_RELAXED);
+    if (avx2 < 0)
+    {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&hasAvx2, avx2, __ATOMIC_RELAXED);
+    }
+    if (avx2)
+    {
+        for (; i < full; i++)
+        {
+            classify_avx2(s + 64 * i, &nl[i], &ws[i], &hash[i]);
+        }
+    }
+    else
+    {
+        for (; i < full; i++)
+        {
+            classify_sse2(s + 64 * i, &nl[i], &ws[i], &hash[i]);
+        }
+    }
+#else
+    for (; i < full; i++)
+    {
+        classify_scalar(s + 64 * i, 64, &nl[i], &ws[i], &hash[i]);
+    }
+#endif
+    if (len % 64)
+    {
+        classify_scalar(s + 64 * full, len % 64, &nl[full], &ws[full], &hash[full]);
+    }
+}
@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "bitset.h"
+#include "search.h"
+
+/*
+ * Implementation of the thread-private reachability search.
+ */
+
+struct searcher {
+    bitset *seen;     // Nodes seen this search, empty between searches.
+    int *queue;       // Node indices, each node is queued at most once.
+    int capacity;
+};
+
+/* Make room for n nodes, counting a new queue in st. */
+static void prepare(searcher *s, int n, search_stats *st)
+{
+    if (n > s->capacity) {
+        alloc_free(s->queue);
+        s->queue = check(alloc_malloc(ALLOC_QUEUE, n * sizeof(*s->queue)));
+        st->allocations++;
+        bitset_clear(s->seen, n);
+        s->capacity = n;
+    }
+}
+
+/* Empty the seen set after a search that queued tail nodes. */
+static void forget(searcher *s, int tail)
+{
+    if (tail < s->capacity / 64) {
+        // Fewer bits than words, unset just those
+        for (int k = 0; k < tail; k++) {
+            bitset_unset(s->seen, s->queue[k]);
+        }
+    } else {
+        bitset_clear(s->seen, s->capacity);
+    }
+}
+
+/**
+ * searcher_empty() - Create a searcher.
+ *
+ * The searcher grows to the size of the graphs it is used on.
+ *
+ * Returns: A pointer to the new searcher.
+ */
+searcher *searcher_empty(void){
+    searcher *s = check(alloc_calloc(ALLOC_QUEUE, 1, sizeof(searcher)));
+    s->seen = bitset_empty();
+    return s;
+}
+
+/**
+ * searcher_find_path() - Check for a path between two nodes.
+ * @s: Searcher owned by the calling thread.
+ * @g: Graph to inspect. Not modified.
+ * @n1: Origin node.
+ * @n2: Destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The search stops as soon as the destination is reached, and is not
+ * started if the nodes are in different components of a labelled
+ * graph. If stats is given it is overwritten with the cost of this
+ * search.
+ *
+ * Returns: True if a path exists from n1 to n2.
+ */
+bool searcher_find_path(searcher *s, const graph *g, const node *n1,
+                        const node *n2, search_stats *stats){
+    search_stats st;
+    stats_reset(&st);
+    st.queries = 1;
+    double start = stats_now();
+    if (!graph_may_reach(g, n1, n2))
+    {
+        st.wall_time = stats_now() - start;
+        if (stats != NULL)
+        {
+            *stats = st;
+        }
+        return false;
+    }
+
+    prepare(s, graph_node_count(g), &st);
+    graph_id target = graph_node_id(g, n2);
+    int head = 0;
+    int tail = 0;
+    bool found = n1 == n2;
+    bitset_test_and_set(s->seen, graph_node_index(g, n1));
+    s->queue[tail++] = graph_node_index(g, n1);
+    st.frontier_peak = 1;
+    while (!found && head < tail)
+    {
+        const node *p = graph_get_node(g, s->queue[head++]);
+        st.nodes_visited++;
+        // Queue every neighbour returned, since all of them are marked
+        // seen and forget() only clears the queued ones
+        neighbour_iter it;
+        graph_id i;
+        graph_unseen_neighbours_begin(g, p, s->seen, &it);
+        while (graph_neighbours_next(g, &it, &i))
+        {
+            s->queue[tail++] = i;
+            if (i == target)
+            {
+                found = true;
+            }
+        }
+        st.edges_relaxed += graph_neighbours_scanned(&it);
+        if ((unsigned long)(tail - head) > st.frontier_peak)
+        {
+            st.frontier_peak = tail - head;
+        }
+    }
+    forget(s, tail);
+    st.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    return found;
+}
+
+/**
+ * searcher_reaching() - Find every node with a path to a node.
+ * @s: Searcher owned by the calling thread.
+ * @g: Graph to inspect, keeping in-edges. Not modified.
+ * @n: Destination node.
+ * @nodes: Set to the indices of the nodes found, in order of distance.
+ *         Valid until the searcher is used again.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * The search follows the in-edges backwards from n, so its cost grows
+ * with the size of the answer and not with the size of the graph. The
+ * node n itself is left out.
+ *
+ * Returns: The number of nodes found.
+ */
+int searcher_reaching(searcher *s, const graph *g, const node *n,
+                      const int **nodes, search_stats *stats){
+    search_stats st;
+    stats_reset(&st);
+    st.queries = 1;
+    double start = stats_now();
+
+    prepare(s, graph_node_count(g), &st);
+    int head = 0;
+    int tail = 0;
+    bitset_test_and_set(s->seen, graph_node_index(g, n));
+    s->queue[tail++] = graph_node_index(g, n);
+    st.frontier_peak = 1;
+    while (head < tail)
+    {
+        const node *p = graph_get_node(g, s->queue[head++]);
+        st.nodes_visited++;
+        neighbour_iter it;
+        graph_id i;
+        graph_in_neighbours_begin(g, p, &it);
+        while (graph_neighbours_next(g, &it, &i))
+        {
+            st.edges_relaxed++;
+            if (!bitset_test_and_set(s->seen, i))
+            {
+                s->queue[tail++] = i;
+            }
+        }
+        if ((unsigned long)(tail - head) > st.frontier_peak)
+        {
+            st.frontier_peak = tail - head;
+        }
+    }
+    forget(s, tail);
+    st.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    *nodes = s->queue + 1;
+    return tail - 1;
+}
+
+/**
+ * searcher_find_path_shm() - Check for a path in a shared graph.
+ * @s: Searcher owned by the calling thread.
+ * @sg: Attached graph to inspect.
+ * @from: Index of the origin node.
+ * @to: Index of the destination node.
+ * @stats: Counters for this search, or NULL if not wanted.
+ *
+ * Works like searcher_find_path(), but reads the neighbours straight
+ * from the segment, so nothing is allocated per visited node.
+ *
+ * Returns: True if a path exists from the origin to the destination.
+ */
+bool searcher_find_path_shm(searcher *s, const shmgraph *sg, int from, int to,
+                            search_stats *stats){
+    search_stats st;
+    stats_reset(&st);
+    st.queries = 1;
+    double start = stats_now();
+
+    prepare(s, shmgraph_node_count(sg), &st);
+    int head = 0;
+    int tail = 0;
+    bool found = from == to;
+    bitset_test_and_set(s->seen, from);
+    s->queue[tail++] = from;
+    st.frontier_peak = 1;
+    while (!found && head < tail)
+    {
+        int count;
+        const uint32_t *neighbours = shmgraph_neighbours(sg, s->queue[head++], &count);
+        st.nodes_visited++;
+        for (int k = 0; k < count; k++)
+        {
+            st.edges_relaxed++;
+            int i = neighbours[k];
+            if (!bitset_test_and_set(s->seen, i))
+            {
+                s->queue[tail++] = i;
+                if (i == to)
+                {
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if ((unsigned long)(tail - head) > st.frontier_peak)
+        {
+            st.frontier_peak = tail - head;
+        }
+    }
+    forget(s, tail);
+    st.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    return found;
+}
+
+/**
+ * searcher_kill() - Destroy a searcher.
+ * @s: Searcher to destroy.
+ *
+ * Returns: Nothing.
+ */
+void searcher_kill(searcher *s){
+    bitset_kill(s->seen);
+    alloc_free(s->queue);
+    alloc_free(s);
+}
@@ -0,0 +1,783 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "alloc.h"
+#include "list.h"
+#include "graph.h"
+#include "strtab.h"
+#include "stats.h"
+#include "histogram.h"
+#include "search.h"
+#include "source.h"
+#include "loader.h"
+#include "pipeline.h"
+#include "reorder.h"
+#include "server.h"
+
+/*
+ * Implementation of the query server.
+ *
+ * Each connection has at most one request with the workers at a time,
+ * which keeps the answers in request order without any sequencing.
+ * Finished requests are handed back to the event loop through a list
+ * and an eventfd, so only the event loop ever touches a connection.
+ */
+
+#define MAX_WORKERS 256
+#define MAX_EVENTS 64
+// Unanswered input or unsent output above which a client is not read.
+#define BACKLOG_BYTES (64 * 1024)
+
+typedef struct conn {
+    int fd;             // -1 once closed, while a request is still out.
+    uint32_t events;    // Events currently asked from epoll.
+    char *in;           // Received bytes, in[inPos..inLen) not handled.
+    size_t inPos;
+    size_t inLen;
+    size_t inCap;
+    char *out;          // Answers, out[outPos..outLen) not sent.
+    size_t outPos;
+    size_t outLen;
+    size_t outCap;
+    bool busy;          // A request is with the workers.
+    bool eof;           // The client will send nothing more.
+    bool dead;          // The connection failed and must be closed.
+    struct conn *prev;
+    struct conn *next;
+} conn;
+
+typedef struct job {
+    conn *c;
+    int result;
+    double queued;
+    struct job *next;
+    char *dest;
+    char origin[];      // Origin and destination, '\0'-separated.
+} job;
+
+// Everything a query reads. Replaced as a whole by a reload.
+typedef struct snapshot {
+    graph *g;
+    list *cities;       // Names of the nodes, owned by the snapshot.
+    strtab *names;      // Node names, id == node index.
+    unsigned long generation;
+} snapshot;
+
+typedef struct server server;
+
+typedef struct worker {
+    server *srv;
+    pthread_t thread;
+    searcher *search;
+    search_stats total;
+    histogram *latency;
+    uint64_t online;    // Epoch when the current request began, 0 if idle.
+} worker;
+
+struct server {
+    const char *map;
+    graph_order order;  // Applied to every reloaded graph.
+    snapshot *current;  // Read atomically, swapped by a reload.
+    uint64_t epoch;     // Advanced on every swap.
+    worker *pool;
+    int workers;
+    pthread_t reloader;
+    bool reloading;     // A reload thread is running, or not yet joined.
+    bool reloadDone;    // Set by the reload thread when it is finished.
+    int epfd;
+    int listenFd;
+    int wakeFd;
+    int sigFd;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    job *head;          // Requests waiting for a worker.
+    job *tail;
+    job *done;          // Answered requests waiting for the event loop.
+    bool stopping;
+    conn *conns;
+    unsigned long connections;
+    unsigned long requests;
+};
+
+/* Make room for len more bytes after *used bytes in a buffer. */
+static char *reserve(char *buf, size_t used, size_t *cap, size_t len)
+{
+    if (used + len > *cap) {
+        while (used + len > *cap) {
+            *cap = *cap ? 2 * *cap : 4096;
+        }
+        buf = check(alloc_realloc(ALLOC_SERVER, buf, *cap));
+    }
+    return buf;
+}
+
+/* Create a snapshot, indexing the node names for lookups. */
+static snapshot *snapshot_create(graph *g, list *cities, unsigned long generation)
+{
+    snapshot *snap = check(alloc_calloc(ALLOC_SERVER, 1, sizeof(snapshot)));
+    snap->g = g;
+    snap->cities = cities;
+    snap->generation = generation;
+    int n = graph_node_count(g);
+    snap->names = strtab_empty(n);
+    for (int i = 0; i < n; i++) {
+        const char *name = graph_node_name(g, graph_get_node(g, i));
+        strtab_intern(snap->names, name, strlen(name), NULL);
+    }
+    return snap;
+}
+
+/* Free a snapshot no reader can see any more. */
+static void snapshot_kill(snapshot *snap)
+{
+    graph_kill(snap->g);
+    list_pos pos = list_first(snap->cities);
+    while (pos != list_end(snap->cities)) {
+        alloc_free(list_inspect(snap->cities, pos));
+        pos = list_next(snap->cities, pos);
+    }
+    list_kill(snap->cities);
+    strtab_kill(snap->names, true);
+    alloc_free(snap);
+}
+
+/* Load a map file like the program does at start, or return NULL. */
+static graph *load_map(const char *map, list *cities, int *numCities, int *numEdges)
+{
+    FILE *in = fopen(map, "r");
+    if (in == NULL) {
+        fprintf(stderr, "Failed to open %s for reading: %s\n", map, strerror(errno));
+        return NULL;
+    }
+    graph *g = NULL;
+    source *src = source_open(in);
+    if (src != NULL) {
+        // One loader thread, so that the workers keep their cores
+        if (source_is_compressed(src)) {
+            g = load_map_pipelined(src, cities, numCities, numEdges);
+        } else {
+            g = load_map_parallel(in, 1, cities, numCities, numEdges);
+        }
+        source_close(src);
+    }
+    fclose(in);
+    return g;
+}
+
+/* Reload thread: build a new snapshot and retire the old one. */
+static void *reload(void *arg)
+{
+    server *srv = arg;
+    double start = stats_now();
+    list *cities = list_empty(NULL);
+    int numCities;
+    int numEdges;
+    graph *g = load_map(srv->map, cities, &numCities, &numEdges);
+    if (g == NULL) {
+        fprintf(stderr, "reload: failed, still serving generation %lu\n",
+                __atomic_load_n(&srv->current, __ATOMIC_SEQ_CST)->generation);
+        list_kill(cities);
+    } else {
+        snapshot *old = __atomic_load_n(&srv->current, __ATOMIC_SEQ_CST);
+        numEdges -= graph_remove_duplicates(g);
+        graph_label_components(g);
+        reorder_graph(g, srv->order);
+        if (graph_is_compact(old->g)) {
+            // Keep serving from the same format as at start
+            graph_compact(g);
+        } else {
+            graph_choose_matrix(g);
+        }
+        snapshot *snap = snapshot_create(g, cities, old->generation + 1);
+        double built = stats_now();
+        __atomic_store_n(&srv->current, snap, __ATOMIC_SEQ_CST);
+        uint64_t epoch = __atomic_add_fetch(&srv->epoch, 1, __ATOMIC_SEQ_CST);
+
+        // Grace period: a worker may still use the old snapshot only if
+        // it went online before the swap and has not gone idle since
+        for (int i = 0; i < srv->workers; i++) {
+            uint64_t e;
+            while ((e = __atomic_load_n(&srv->pool[i].online, __ATOMIC_SEQ_CST)) != 0 &&
+                   e < epoch) {
+                struct timespec pause = { 0, 100000 };
+                nanosleep(&pause, NULL);
+            }
+        }
+        snapshot_kill(old);
+        fprintf(stderr, "reload: generation=%lu nodes=%d edges=%d build=%.6fs grace=%.6fs\n",
+                snap->generation, numCities, numEdges, built - start, stats_now() - built);
+    }
+    __atomic_store_n(&srv->reloadDone, true, __ATOMIC_SEQ_CST);
+    uint64_t one = 1;
+    while (write(srv->wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+    return NULL;
+}
+
+/* Start a reload unless one is running. Runs on the event loop. */
+static bool start_reload(server *srv)
+{
+    if (srv->reloading) {
+        return false;
+    }
+    if (pthread_create(&srv->reloader, NULL, reload, srv)) {
+        fprintf(stderr, "Failed to start the reload thread\n");
+        return false;
+    }
+    srv->reloading = true;
+    return true;
+}
+
+/* Answer one request from a snapshot. Runs on a worker thread. */
+static void answer(worker *w, const snapshot *snap, job *j)
+{
+    int from = strtab_lookup(snap->names, j->origin, strlen(j->origin));
+    int to = strtab_lookup(snap->names, j->dest, strlen(j->dest));
+    if (from < 0 || to < 0) {
+        j->result = -1;
+        return;
+    }
+    search_stats st;
+    bool found = searcher_find_path(w->search, snap->g, graph_get_node(snap->g, from),
+                                    graph_get_node(snap->g, to), &st);
+    j->result = found ? 1 : 0;
+    stats_add(&w->total, &st);
+    histogram_record(w->latency, (uint64_t)((stats_now() - j->queued) * 1e9));
+}
+
+/* Worker thread: answer requests until the server stops. */
+static void *work(void *arg)
+{
+    worker *w = arg;
+    server *srv = w->srv;
+    for (;;) {
+        pthread_mutex_lock(&srv->lock);
+        while (srv->head == NULL && !srv->stopping) {
+            pthread_cond_wait(&srv->ready, &srv->lock);
+        }
+        job *j = srv->head;
+        if (j == NULL) {
+            pthread_mutex_unlock(&srv->lock);
+            return NULL;
+        }
+        srv->head = j->next;
+        if (srv->head == NULL) {
+            srv->tail = NULL;
+        }
+        pthread_mutex_unlock(&srv->lock);
+
+        // Go online before reading the snapshot pointer, so that a
+        // reload swapping it meanwhile waits for this request
+        __atomic_store_n(&w->online, __atomic_load_n(&srv->epoch, __ATOMIC_SEQ_CST),
+                         __ATOMIC_SEQ_CST);
+        answer(w, __atomic_load_n(&srv->current, __ATOMIC_SEQ_CST), j);
+        __atomic_store_n(&w->online, 0, __ATOMIC_SEQ_CST);
+
+        pthread_mutex_lock(&srv->lock);
+        j->next = srv->done;
+        srv->done = j;
+        pthread_mutex_unlock(&srv->lock);
+        uint64_t one = 1;
+        while (write(srv->wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+/* Queue an answer line for a connection. */
+static void reply(conn *c, const char *s)
+{
+    size_t len = strlen(s);
+    c->out = reserve(c->out, c->outLen, &c->outCap, len);
+    memcpy(c->out + c->outLen, s, len);
+    c->outLen += len;
+}
+
+/* Hand a request line to the workers, or answer it if malformed. */
+static void submit(server *srv, conn *c, char *line, size_t len)
+{
+    if (len > 0 && line[len - 1] == '\r') {
+        len--;
+    }
+    // Split into exactly two white-space separated names
+    size_t a = 0;
+    while (a < len && (line[a] == ' ' || line[a] == '\t')) {
+        a++;
+    }
+    size_t aEnd = a;
+    while (aEnd < len && line[aEnd] != ' ' && line[aEnd] != '\t') {
+        aEnd++;
+    }
+    size_t b = aEnd;
+    while (b < len && (line[b] == ' ' || line[b] == '\t')) {
+        b++;
+    }
+    size_t bEnd = b;
+    while (bEnd < len && line[bEnd] != ' ' && line[bEnd] != '\t') {
+        bEnd++;
+    }
+    size_t rest = bEnd;
+    while (rest < len && (line[rest] == ' ' || line[rest] == '\t')) {
+        rest++;
+    }
+    if (a == len) {
+        return;     // Blank line
+    }
+    if (b == len && aEnd - a == 6 && !memcmp(line + a, "reload", 6)) {
+        reply(c, start_reload(srv) ? "OK reloading\n" : "ERR reload already running\n");
+        return;
+    }
+    if (b == bEnd || rest != len) {
+        reply(c, "ERR expected origin and destination\n");
+        return;
+    }
+
+    job *j = check(alloc_malloc(ALLOC_SERVER, sizeof(job) + (aEnd - a) + (bEnd - b) + 2));
+    memcpy(j->origin, line + a, aEnd - a);
+    j->origin[aEnd - a] = '\0';
+    j->dest = j->origin + (aEnd - a) + 1;
+    memcpy(j->dest, line + b, bEnd - b);
+    j->dest[bEnd - b] = '\0';
+    j->c = c;
+    j->next = NULL;
+    j->queued = stats_now();
+    c->busy = true;
+    srv->requests++;
+
+    pthread_mutex_lock(&srv->lock);
+    if (srv->tail != NULL) {
+        srv->tail->next = j;
+    } else {
+        srv->head = j;
+    }
+    srv->tail = j;
+    pthread_cond_signal(&srv->ready);
+    pthread_mutex_unlock(&srv->lock);
+}
+
+/* Submit the next complete request line, if the connection is idle. */
+static void dispatch(server *srv, conn *c)
+{
+    while (!c->busy && c->outLen - c->outPos < BACKLOG_BYTES) {
+        char *p = c->in + c->inPos;
+        size_t avail = c->inLen - c->inPos;
+        char *nl = memchr(p, '\n', avail);
+        if (nl == NULL) {
+            if (avail >= SERVER_LINE_MAX) {
+                reply(c, "ERR line too long\n");
+                c->inPos = c->inLen;
+                c->eof = true;
+            } else if (c->eof && avail > 0) {
+                // A last request without a newline
+                c->inPos = c->inLen;
+                submit(srv, c, p, avail);
+            }
+            break;
+        }
+        c->inPos += nl + 1 - p;
+        submit(srv, c, p, nl - p);
+    }
+    if (c->inPos == c->inLen) {
+        c->inPos = c->inLen = 0;
+    }
+}
+
+/* Send as much queued output as the socket takes. */
+static void flush(conn *c)
+{
+    while (c->outPos < c->outLen) {
+        ssize_t n = send(c->fd, c->out + c->outPos, c->outLen - c->outPos, MSG_NOSIGNAL);
+        if (n > 0) {
+            c->outPos += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                c->dead = true;
+            }
+            return;
+        }
+    }
+    c->outPos = c->outLen = 0;
+}
+
+/* Remove a connection from epoll and free it unless a request is out. */
+static void conn_close(server *srv, conn *c)
+{
+    if (c->fd >= 0) {
+        epoll_ctl(srv->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+    }
+    if (c->busy) {
+        return;     // Freed when the answer comes back
+    }
+    if (c->prev != NULL) {
+        c->prev->next = c->next;
+    } else {
+        srv->conns = c->next;
+    }
+    if (c->next != NULL) {
+        c->next->prev = c->prev;
+    }
+    alloc_free(c->in);
+    alloc_free(c->out);
+    alloc_free(c);
+}
+
+/* Make progress on a connection after anything about it changed. */
+static void conn_update(server *srv, conn *c)
+{
+    if (c->fd < 0) {
+        conn_close(srv, c);
+        return;
+    }
+    if (!c->dead) {
+        dispatch(srv, c);
+        flush(c);
+    }
+    if (c->dead || (c->eof && !c->busy && c->outPos == c->outLen)) {
+        conn_close(srv, c);
+        return;
+    }
+    uint32_t events = 0;
+    if (!c->eof && c->inLen - c->inPos < BACKLOG_BYTES) {
+        events |= EPOLLIN;
+    }
+    if (c->outPos < c->outLen) {
+        events |= EPOLLOUT;
+    }
+    if (events != c->events) {
+        struct epoll_event ev = { .events = events, .data.ptr = c };
+        epoll_ctl(srv->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+        c->events = events;
+    }
+}
+
+/* Read everything the client has sent so far. */
+static void conn_read(conn *c)
+{
+    for (;;) {
+        c->in = reserve(c->in, c->inLen, &c->inCap, 4096);
+        ssize_t n = read(c->fd, c->in + c->inLen, c->inCap - c->inLen);
+        if (n > 0) {
+            c->inLen += n;
+            if (c->inLen - c->inPos >= BACKLOG_BYTES) {
+                return;
+            }
+        } else if (n == 0) {
+            c->eof = true;
+            return;
+        } else if (errno == EINTR) {
+            continue;
+        } else {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                c->dead = true;
+            }
+            return;
+        }
+    }
+}
+
+/* Accept all pending connections. */
+static void accept_all(server *srv)
+{
+    for (;;) {
+        int fd = accept(srv->listenFd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "Failed to accept a client: %s\n", strerror(errno));
+            }
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        conn *c = check(alloc_calloc(ALLOC_SERVER, 1, sizeof(conn)));
+        c->fd = fd;
+        c->events = EPOLLIN;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = c };
+        if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            alloc_free(c);
+            continue;
+        }
+        c->next = srv->conns;
+        if (srv->conns != NULL) {
+            srv->conns->prev = c;
+        }
+        srv->conns = c;
+        srv->connections++;
+    }
+}
+
+/* Deliver the answers the workers have finished. */
+static void collect(server *srv)
+{
+    uint64_t count;
+    while (read(srv->wakeFd, &count, sizeof(count)) < 0 && errno == EINTR) {
+    }
+    pthread_mutex_lock(&srv->lock);
+    job *j = srv->done;
+    srv->done = NULL;
+    pthread_mutex_unlock(&srv->lock);
+    while (j != NULL) {
+        job *next = j->next;
+        conn *c = j->c;
+        c->busy = false;
+        if (c->fd >= 0) {
+            reply(c, j->result > 0 ? "1\n" : j->result == 0 ? "0\n" : "-1\n");
+        }
+        alloc_free(j);
+        conn_update(srv, c);
+        j = next;
+    }
+    if (__atomic_load_n(&srv->reloadDone, __ATOMIC_SEQ_CST)) {
+        pthread_join(srv->reloader, NULL);
+        srv->reloadDone = false;
+        srv->reloading = false;
+    }
+}
+
+/* Open, bind and listen on a non-blocking Unix domain socket. */
+static int listen_on(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "Failed to listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+/**
+ * server_run() - Answer queries on a Unix domain socket until stopped.
+ * @path: Path of the socket. A stale socket file is replaced.
+ * @map: Map file that g was loaded from, read again on a reload.
+ * @g: Graph to query first. If it is compact, reloaded graphs are too.
+ * @cities: List of the city names of g.
+ * @order: Order that g was renumbered in, reloaded graphs are too.
+ * @workers: Number of search threads, 0 means one per core.
+ * @showStats: If true, print the totals and latency on exit.
+ *
+ * The server takes over g, cities and the names in it, and frees them
+ * when they have been replaced or the server stops.
+ *
+ * Returns: 0 after a normal stop, -1 if the server could not start.
+ */
+int server_run(const char *path, const char *map, graph *g, list *cities,
+               graph_order order, int workers, bool showStats){
+    server srv;
+    memset(&srv, 0, sizeof(srv));
+    srv.map = map;
+    srv.order = order;
+    srv.epoch = 1;
+
+    if (workers <= 0)
+    {
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    if (workers < 1)
+    {
+        workers = 1;
+    }
+    if (workers > MAX_WORKERS)
+    {
+        workers = MAX_WORKERS;
+    }
+
+    srv.current = snapshot_create(g, cities, 0);
+
+    // Stop and reload signals are read from a descriptor by the event
+    // loop. They are blocked before any thread starts, so all inherit it.
+    sigset_t handled, saved;
+    sigemptyset(&handled);
+    sigaddset(&handled, SIGINT);
+    sigaddset(&handled, SIGTERM);
+    sigaddset(&handled, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &handled, &saved);
+
+    srv.listenFd = listen_on(path);
+    srv.wakeFd = eventfd(0, EFD_NONBLOCK);
+    srv.sigFd = signalfd(-1, &handled, SFD_NONBLOCK);
+    srv.epfd = epoll_create1(0);
+    if (srv.listenFd < 0 || srv.wakeFd < 0 || srv.sigFd < 0 || srv.epfd < 0)
+    {
+        if (srv.listenFd >= 0)
+        {
+            fprintf(stderr, "Failed to start server: %s\n", strerror(errno));
+            close(srv.listenFd);
+            unlink(path);
+        }
+        snapshot_kill(srv.current);
+        pthread_sigmask(SIG_SETMASK, &saved, NULL);
+        return -1;
+    }
+    // The listening, wake-up and signal descriptors are told apart from
+    // connections by the address of their field
+    int *special[] = { &srv.listenFd, &srv.wakeFd, &srv.sigFd };
+    for (int i = 0; i < 3; i++)
+    {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = special[i] };
+        epoll_ctl(srv.epfd, EPOLL_CTL_ADD, *special[i], &ev);
+    }
+
+    pthread_mutex_init(&srv.lock, NULL);
+    pthread_cond_init(&srv.ready, NULL);
+    worker *pool = check(alloc_calloc(ALLOC_SERVER, workers, sizeof(worker)));
+    srv.pool = pool;
+    srv.workers = workers;
+    for (int i = 0; i < workers; i++)
+    {
+        pool[i].srv = &srv;
+        pool[i].search = searcher_empty();
+        pool[i].latency = histogram_empty();
+        stats_reset(&pool[i].total);
+        if (pthread_create(&pool[i].thread, NULL, work, &pool[i]))
+        {
+            fprintf(stderr, "Failed to start worker threads\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    fprintf(stderr, "Serving %d cities on %s with %d workers\n",
+            graph_node_count(g), path, workers);
+
+    bool running = true;
+    struct epoll_event events[MAX_EVENTS];
+    while (running)
+    {
+        int count = epoll_wait(srv.epfd, events, MAX_EVENTS, -1);
+        if (count < 0 && errno != EINTR)
+        {
+            fprintf(stderr, "epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < count; i++)
+        {
+            void *p = events[i].data.ptr;
+            if (p == &srv.listenFd)
+            {
+                accept_all(&srv);
+            }
+            else if (p == &srv.wakeFd)
+            {
+                collect(&srv);
+            }
+            else if (p == &srv.sigFd)
+            {
+                // Consume the signals so they are not delivered once
+                // unblocked
+                struct signalfd_siginfo info;
+                while (read(srv.sigFd, &info, sizeof(info)) > 0)
+                {
+                    if (info.ssi_signo == SIGHUP)
+                    {
+                        start_reload(&srv);
+                    }
+                    else
+                    {
+                        running = false;
+                    }
+                }
+            }
+            else
+            {
+                conn *c = p;
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    conn_read(c);
+                }
+                if (events[i].events & (EPOLLHUP | EPOLLERR))
+                {
+                    // The client is gone both ways, nothing can be sent
+                    c->dead = true;
+                }
+                conn_update(&srv, c);
+            }
+        }
+    }
+
+    // A reload waits for the workers, so let it finish first
+    if (srv.reloading)
+    {
+        pthread_join(srv.reloader, NULL);
+    }
+    // Let the workers finish what is queued, then drop all clients
+    pthread_mutex_lock(&srv.lock);
+    srv.stopping = true;
+    pthread_cond_broadcast(&srv.ready);
+    pthread_mutex_unlock(&srv.lock);
+    search_stats total;
+    stats_reset(&total);
+    histogram *latency = histogram_empty();
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_join(pool[i].thread, NULL);
+        stats_add(&total, &pool[i].total);
+        histogram_merge(latency, pool[i].latency);
+        searcher_kill(pool[i].search);
+        alloc_free(pool[i].latency);
+    }
+    alloc_free(pool);
+    while (srv.done != NULL)
+    {
+        job *next = srv.done->next;
+        srv.done->c->busy = false;
+        alloc_free(srv.done);
+        srv.done = next;
+    }
+    while (srv.conns != NULL)
+    {
+        conn_close(&srv, srv.conns);
+    }
+
+    if (showStats)
+    {
+        fprintf(stderr, "server: connections=%lu requests=%lu\n",
+                srv.connections, srv.requests);
+        stats_print(stderr, "total", &total);
+        histogram_report(stderr, "latency", latency);
+    }
+    alloc_free(latency);
+
+    close(srv.epfd);
+    close(srv.sigFd);
+    close(srv.wakeFd);
+    close(srv.listenFd);
+    unlink(path);
+    pthread_mutex_destroy(&srv.lock);
+    pthread_cond_destroy(&srv.ready);
+    snapshot_kill(srv.current);
+    pthread_sigmask(SIG_SETMASK, &saved, NULL);
+    return 0;
+}
@@ -0,0 +1,405 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "alloc.h"
+#include "shmgraph.h"
+
+/*
+ * Implementation of the shared memory graph segment.
+ */
+
+#define SHM_MAGIC "ISCONGRF"
+#define SHM_VERSION 1
+
+// Start of the segment. All offsets are in bytes from here.
+typedef struct shm_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t ready;       // Set last, once the rest has been written.
+    uint64_t size;        // Size of the whole segment.
+    uint32_t numNodes;
+    uint32_t numEdges;
+    uint32_t numSlots;    // A power of two.
+    uint32_t unused;
+    uint64_t first;       // uint32_t[numNodes + 1]
+    uint64_t targets;     // uint32_t[numEdges]
+    uint64_t nameAt;      // uint64_t[numNodes + 1]
+    uint64_t names;       // char[nameAt[numNodes]]
+    uint64_t slots;       // uint32_t[numSlots]
+} shm_header;
+
+struct shmgraph {
+    const char *base;
+    size_t size;
+    const shm_header *h;
+    const uint32_t *first;
+    const uint32_t *targets;
+    const uint64_t *nameAt;
+    const char *names;
+    const uint32_t *slots;
+};
+
+/* FNV-1a hash of a string. */
+static uint32_t hash(const char *s)
+{
+    uint32_t h = 2166136261u;
+    for (; *s != '\0'; s++) {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Return the segment name with its leading '/', or NULL if too long. */
+static const char *segment_name(const char *name, char *buf, size_t size)
+{
+    if (name[0] == '/') {
+        return name;
+    }
+    if ((size_t)snprintf(buf, size, "/%s", name) >= size) {
+        fprintf(stderr, "Shared memory name %s is too long\n", name);
+        return NULL;
+    }
+    return buf;
+}
+
+/* Round an offset up to the next multiple of 8. */
+static uint64_t align8(uint64_t off)
+{
+    return (off + 7) & ~(uint64_t)7;
+}
+
+/* Place a section of count elements after off and move off past it. */
+static uint64_t section(uint64_t *off, uint64_t count, size_t elem)
+{
+    uint64_t start = align8(*off);
+    *off = start + count * elem;
+    return start;
+}
+
+/**
+ * shmgraph_build() - Write a graph into a new shared memory segment.
+ * @name: Name of the segment, such as "/airmap". A missing leading '/'
+ *        is added.
+ * @g: Graph to write. Not modified.
+ * @bytes: Set to the size of the segment, or NULL if not wanted.
+ *
+ * A segment of the same name is replaced. Processes that have the old
+ * segment attached keep using it until they detach.
+ *
+ * Returns: 0 on success, or -1 after printing an error message.
+ */
+int shmgraph_build(const char *name, const graph *g, size_t *bytes){
+    char buf[NAME_MAX + 1];
+    name = segment_name(name, buf, sizeof(buf));
+    if (name == NULL)
+    {
+        return -1;
+    }
+
+    // Gather the adjacency first, the segment size depends on it
+    int n = graph_node_count(g);
+    uint32_t *first = check(alloc_malloc(ALLOC_LOADER, (n + 1) * sizeof(uint32_t)));
+    uint32_t *targets = NULL;
+    size_t numEdges = 0;
+    size_t cap = 0;
+    uint64_t nameBytes = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const node *from = graph_get_node(g, i);
+        first[i] = numEdges;
+        nameBytes += strlen(graph_node_name(g, from)) + 1;
+        neighbour_iter it;
+        graph_id id;
+        graph_neighbours_begin(g, from, &it);
+        while (graph_neighbours_next(g, &it, &id))
+        {
+            if (numEdges == cap)
+            {
+                cap = cap ? 2 * cap : 1024;
+                targets = check(alloc_realloc(ALLOC_LOADER, targets, cap * sizeof(uint32_t)));
+            }
+            targets[numEdges++] = id;
+        }
+    }
+    first[n] = numEdges;
+    if (numEdges > UINT32_MAX)
+    {
+        fprintf(stderr, "Too many edges for a shared memory graph\n");
+        alloc_free(first);
+        alloc_free(targets);
+        return -1;
+    }
+    // Keep the hash table at most half full
+    uint32_t numSlots = 2;
+    while (numSlots < 2 * (uint64_t)n)
+    {
+        numSlots *= 2;
+    }
+
+    shm_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SHM_MAGIC, sizeof(h.magic));
+    h.version = SHM_VERSION;
+    h.numNodes = n;
+    h.numEdges = numEdges;
+    h.numSlots = numSlots;
+    uint64_t off = sizeof(h);
+    h.first = section(&off, n + 1, sizeof(uint32_t));
+    h.targets = section(&off, numEdges, sizeof(uint32_t));
+    h.nameAt = section(&off, n + 1, sizeof(uint64_t));
+    h.names = section(&off, nameBytes, 1);
+    h.slots = section(&off, numSlots, sizeof(uint32_t));
+    h.size = align8(off);
+
+    // Processes attached to an old segment keep it until they detach
+    if (shm_unlink(name) != 0 && errno != ENOENT)
+    {
+        fprintf(stderr, "Failed to remove shared memory %s: %s\n", name, strerror(errno));
+    }
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to create shared memory %s: %s\n", name, strerror(errno));
+        alloc_free(first);
+        alloc_free(targets);
+        return -1;
+    }
+    char *base = MAP_FAILED;
+    if (ftruncate(fd, h.size) == 0)
+    {
+        base = mmap(NULL, h.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map shared memory %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        alloc_free(first);
+        alloc_free(targets);
+        return -1;
+    }
+
+    // The new segment is zero filled, which leaves every slot free
+    memcpy(base + h.first, first, (n + 1) * sizeof(uint32_t));
+    if (numEdges > 0)
+    {
+        memcpy(base + h.targets, targets, numEdges * sizeof(uint32_t));
+    }
+    uint64_t *nameAt = (uint64_t *)(base + h.nameAt);
+    uint32_t *slots = (uint32_t *)(base + h.slots);
+    uint64_t at = 0;
+    for (int i = 0; i < n; i++)
+    {
+        const char *city = graph_node_name(g, graph_get_node(g, i));
+        size_t len = strlen(city) + 1;
+        memcpy(base + h.names + at, city, len);
+        nameAt[i] = at;
+        at += len;
+        uint32_t s = hash(city) & (numSlots - 1);
+        while (slots[s] != 0)
+        {
+            s = (s + 1) & (numSlots - 1);
+        }
+        slots[s] = i + 1;
+    }
+    nameAt[n] = at;
+    alloc_free(first);
+    alloc_free(targets);
+
+    // An attach that races the build sees ready == 0 and gives up
+    memcpy(base, &h, sizeof(h));
+    __atomic_store_n(&((shm_header *)base)->ready, 1, __ATOMIC_RELEASE);
+    munmap(base, h.size);
+    if (bytes != NULL)
+    {
+        *bytes = h.size;
+    }
+    return 0;
+}
+
+/* Check that a section lies inside the segment. */
+static bool fits(uint64_t off, uint64_t count, size_t elem, uint64_t size)
+{
+    return off % 8 == 0 && off <= size && count <= (size - off) / elem;
+}
+
+/**
+ * shmgraph_attach() - Map a shared graph read-only.
+ * @name: Name of the segment given to shmgraph_build().
+ *
+ * Returns: A pointer to the attached graph, or NULL after printing an
+ * error message if the segment is missing or not a complete graph.
+ */
+shmgraph *shmgraph_attach(const char *name){
+    char buf[NAME_MAX + 1];
+    name = segment_name(name, buf, sizeof(buf));
+    if (name == NULL)
+    {
+        return NULL;
+    }
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to open shared memory %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_header))
+    {
+        fprintf(stderr, "ERROR: Shared memory %s does not hold a graph!\n", name);
+        close(fd);
+        return NULL;
+    }
+    const char *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        fprintf(stderr, "Failed to map shared memory %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+
+    const shm_header *h = (const shm_header *)base;
+    uint64_t size = st.st_size;
+    bool ok = !memcmp(h->magic, SHM_MAGIC, sizeof(h->magic)) &&
+              h->version == SHM_VERSION &&
+              __atomic_load_n(&h->ready, __ATOMIC_ACQUIRE) == 1 &&
+              h->size == size && h->numNodes < INT_MAX && h->numEdges < INT_MAX &&
+              h->numSlots > h->numNodes && (h->numSlots & (h->numSlots - 1)) == 0 &&
+              fits(h->first, h->numNodes + 1ull, sizeof(uint32_t), size) &&
+              fits(h->targets, h->numEdges, sizeof(uint32_t), size) &&
+              fits(h->nameAt, h->numNodes + 1ull, sizeof(uint64_t), size) &&
+              fits(h->slots, h->numSlots, sizeof(uint32_t), size);
+    if (ok)
+    {
+        const uint64_t *nameAt = (const uint64_t *)(base + h->nameAt);
+        const uint32_t *first = (const uint32_t *)(base + h->first);
+        ok = h->names <= size && nameAt[h->numNodes] <= size - h->names &&
+             first[h->numNodes] == h->numEdges;
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "ERROR: Shared memory %s does not hold a complete graph!\n", name);
+        munmap((void *)base, st.st_size);
+        return NULL;
+    }
+
+    shmgraph *sg = check(alloc_malloc(ALLOC_GRAPH, sizeof(shmgraph)));
+    sg->base = base;
+    sg->size = size;
+    sg->h = h;
+    sg->first = (const uint32_t *)(base + h->first);
+    sg->targets = (const uint32_t *)(base + h->targets);
+    sg->nameAt = (const uint64_t *)(base + h->nameAt);
+    sg->names = base + h->names;
+    sg->slots = (const uint32_t *)(base + h->slots);
+    return sg;
+}
+
+/**
+ * shmgraph_node_count() - Return the number of nodes.
+ * @sg: Attached graph.
+ *
+ * Returns: The number of nodes.
+ */
+int shmgraph_node_count(const shmgraph *sg){
+    return sg->h->numNodes;
+}
+
+/**
+ * shmgraph_edge_count() - Return the number of edges.
+ * @sg: Attached graph.
+ *
+ * Returns: The number of edges.
+ */
+int shmgraph_edge_count(const shmgraph *sg){
+    return sg->h->numEdges;
+}
+
+/**
+ * shmgraph_size() - Return the size of the segment.
+ * @sg: Attached graph.
+ *
+ * Returns: The size of the segment in bytes.
+ */
+size_t shmgraph_size(const shmgraph *sg){
+    return sg->size;
+}
+
+/**
+ * shmgraph_lookup() - Find a node by its name.
+ * @sg: Attached graph.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the node, or -1 if there is no such city.
+ */
+int shmgraph_lookup(const shmgraph *sg, const char *name){
+    uint32_t mask = sg->h->numSlots - 1;
+    uint32_t s = hash(name) & mask;
+    while (sg->slots[s] != 0)
+    {
+        int i = sg->slots[s] - 1;
+        if (!strcmp(sg->names + sg->nameAt[i], name))
+        {
+            return i;
+        }
+        s = (s + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * shmgraph_neighbours() - Return the neighbours of a node.
+ * @sg: Attached graph.
+ * @i: Index of the node.
+ * @count: Set to the number of neighbours.
+ *
+ * Returns: The node indices of the neighbours, in the segment.
+ */
+const uint32_t *shmgraph_neighbours(const shmgraph *sg, int i, int *count){
+    *count = sg->first[i + 1] - sg->first[i];
+    return sg->targets + sg->first[i];
+}
+
+/**
+ * shmgraph_detach() - Unmap a shared graph. The segment is kept.
+ * @sg: Attached graph.
+ *
+ * Returns: Nothing.
+ */
+void shmgraph_detach(shmgraph *sg){
+    munmap((void *)sg->base, sg->size);
+    alloc_free(sg);
+}
+
+/**
+ * shmgraph_unlink() - Remove a shared memory segment.
+ * @name: Name of the segment.
+ *
+ * Attached processes keep their mapping. The memory is returned when
+ * the last of them detaches.
+ *
+ * Returns: 0 on success, or -1 after printing an error message.
+ */
+int shmgraph_unlink(const char *name){
+    char buf[NAME_MAX + 1];
+    name = segment_name(name, buf, sizeof(buf));
+    if (name == NULL)
+    {
+        return -1;
+    }
+    if (shm_unlink(name) != 0)
+    {
+        fprintf(stderr, "Failed to remove shared memory %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
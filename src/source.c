@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "alloc.h"
+#include "source.h"
+
+/*
+ * Implementation of the map byte source.
+ */
+
+// Compressed bytes read from the file at a time.
+#define INPUT_SIZE (1 << 18)
+
+typedef enum format {
+    FORMAT_PLAIN,
+    FORMAT_GZIP,
+    FORMAT_ZSTD
+} format;
+
+struct source {
+    int fd;
+    format fmt;
+    bool regular;       // The file can be read again with pread().
+    char prefix[4];     // Bytes read while recognizing a pipe's format.
+    size_t prefixLen;
+    size_t prefixPos;
+    char *input;        // Compressed bytes not yet decompressed.
+    bool frameDone;     // True between two compressed members/frames.
+    char *peek;         // Decoded bytes returned by source_peek().
+    size_t peekLen;
+    size_t peekPos;
+#ifdef HAVE_ZLIB
+    z_stream z;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd;
+    ZSTD_inBuffer zin;
+#endif
+};
+
+/* Read raw file bytes, starting with any bytes kept from recognition. */
+static ssize_t raw_read(source *s, char *buf, size_t len)
+{
+    if (s->prefixPos < s->prefixLen) {
+        size_t n = s->prefixLen - s->prefixPos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(buf, s->prefix + s->prefixPos, n);
+        s->prefixPos += n;
+        return n;
+    }
+    ssize_t n;
+    do {
+        n = read(s->fd, buf, len);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        fprintf(stderr, "Failed to read map: %s\n", strerror(errno));
+    }
+    return n;
+}
+
+/* Recognize the format from the magic number at the start of the file. */
+static format recognize(const unsigned char *m, size_t len)
+{
+    if (len >= 2 && m[0] == 0x1f && m[1] == 0x8b) {
+        return FORMAT_GZIP;
+    }
+    if (len >= 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd) {
+        return FORMAT_ZSTD;
+    }
+    return FORMAT_PLAIN;
+}
+
+#ifdef HAVE_ZLIB
+/* Decompress gzip members until some output has been produced. */
+static ssize_t gzip_read(source *s, char *buf, size_t len)
+{
+    s->z.next_out = (Bytef *)buf;
+    s->z.avail_out = len;
+    while (s->z.avail_out == len) {
+        if (s->z.avail_in == 0) {
+            ssize_t n = raw_read(s, s->input, INPUT_SIZE);
+            if (n < 0) {
+                return -1;
+            }
+            if (n == 0) {
+                if (!s->frameDone) {
+                    fprintf(stderr, "ERROR: Compressed map is truncated!\n");
+                    return -1;
+                }
+                break;
+            }
+            s->z.next_in = (Bytef *)s->input;
+            s->z.avail_in = n;
+        }
+        int r = inflate(&s->z, Z_NO_FLUSH);
+        if (r == Z_STREAM_END) {
+            // Another gzip member may follow, as in concatenated files
+            s->frameDone = true;
+            inflateReset(&s->z);
+        } else if (r == Z_OK) {
+            s->frameDone = false;
+        } else if (r != Z_BUF_ERROR) {
+            fprintf(stderr, "ERROR: Bad compressed map: %s\n",
+                    s->z.msg ? s->z.msg : "inflate failed");
+            return -1;
+        }
+    }
+    return len - s->z.avail_out;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/* Decompress zstd frames until some output has been produced. */
+static ssize_t zstd_read(source *s, char *buf, size_t len)
+{
+    ZSTD_outBuffer out = { buf, len, 0 };
+    while (out.pos == 0) {
+        if (s->zin.pos == s->zin.size) {
+            ssize_t n = raw_read(s, s->input, INPUT_SIZE);
+            if (n < 0) {
+                return -1;
+            }
+            if (n == 0) {
+                if (!s->frameDone) {
+                    fprintf(stderr, "ERROR: Compressed map is truncated!\n");
+                    return -1;
+                }
+                break;
+            }
+            s->zin.src = s->input;
+            s->zin.size = n;
+            s->zin.pos = 0;
+        }
+        size_t r = ZSTD_decompressStream(s->zstd, &out, &s->zin);
+        if (ZSTD_isError(r)) {
+            fprintf(stderr, "ERROR: Bad compressed map: %s\n", ZSTD_getErrorName(r));
+            return -1;
+        }
+        s->frameDone = r == 0;
+    }
+    return out.pos;
+}
+#endif
+
+/**
+ * source_open() - Create a source reading from a map file.
+ * @in: Map file opened for reading. Nothing may have been read from it.
+ *
+ * For a regular file the first bytes are inspected without moving the
+ * file position, so the file can still be read directly if the source
+ * turns out not to be compressed.
+ *
+ * Returns: A pointer to the new source, or NULL if the file is in a
+ * compressed format this build can not read.
+ */
+source *source_open(FILE *in){
+    source *s = check(alloc_calloc(ALLOC_LOADER, 1, sizeof(*s)));
+    s->fd = fileno(in);
+    struct stat st;
+    s->regular = fstat(s->fd, &st) == 0 && S_ISREG(st.st_mode);
+    if (s->regular)
+    {
+        unsigned char magic[4];
+        ssize_t n = pread(s->fd, magic, sizeof(magic), 0);
+        s->fmt = recognize(magic, n > 0 ? n : 0);
+    }
+    else
+    {
+        // A pipe can not be rewound, so keep the bytes for source_read()
+        ssize_t n;
+        while (s->prefixLen < sizeof(s->prefix) &&
+               (n = raw_read(s, s->prefix + s->prefixLen, sizeof(s->prefix) - s->prefixLen)) > 0)
+        {
+            s->prefixLen += n;
+        }
+        s->fmt = recognize((unsigned char *)s->prefix, s->prefixLen);
+    }
+
+    if (s->fmt == FORMAT_PLAIN)
+    {
+        return s;
+    }
+    s->input = check(alloc_malloc(ALLOC_LOADER, INPUT_SIZE));
+    s->frameDone = true;
+#ifdef HAVE_ZLIB
+    if (s->fmt == FORMAT_GZIP)
+    {
+        // 15 + 32: largest window, gzip or zlib header detected
+        if (inflateInit2(&s->z, 15 + 32) == Z_OK)
+        {
+            return s;
+        }
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (s->fmt == FORMAT_ZSTD)
+    {
+        s->zstd = ZSTD_createDStream();
+        if (s->zstd != NULL)
+        {
+            ZSTD_initDStream(s->zstd);
+            return s;
+        }
+    }
+#endif
+    fprintf(stderr, "ERROR: This build can not read %s compressed maps "
+            "(build with -D%s)\n", s->fmt == FORMAT_GZIP ? "gzip" : "zstd",
+            s->fmt == FORMAT_GZIP ? "HAVE_ZLIB -lz" : "HAVE_ZSTD -lzstd");
+    alloc_free(s->input);
+    alloc_free(s);
+    return NULL;
+}
+
+/**
+ * source_is_compressed() - Check if a source decompresses its file.
+ * @s: Source to inspect.
+ *
+ * Returns: True if the file is compressed, otherwise false.
+ */
+bool source_is_compressed(const source *s){
+    return s->fmt != FORMAT_PLAIN;
+}
+
+/* Read and decode the next bytes of the file. */
+static ssize_t decode_read(source *s, char *buf, size_t len)
+{
+#ifdef HAVE_ZLIB
+    if (s->fmt == FORMAT_GZIP)
+    {
+        return gzip_read(s, buf, len);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (s->fmt == FORMAT_ZSTD)
+    {
+        return zstd_read(s, buf, len);
+    }
+#endif
+    return raw_read(s, buf, len);
+}
+
+/**
+ * source_peek() - Look at the first bytes of the (decompressed) map.
+ * @s: Source to look at. Nothing may have been read from it.
+ * @buf: Buffer receiving the bytes.
+ * @len: Size of buf.
+ *
+ * A plain regular file is read with pread(), other files are decoded
+ * and the bytes kept, so source_read() still starts at the beginning
+ * of the map. Only the bytes of the first peek are kept. A stream is
+ * only read until its first line is complete, so a slow pipe is not
+ * waited on for more than that.
+ *
+ * Returns: The number of bytes copied to buf, at least the whole first
+ * line unless it is longer than len, or -1 on an error, in which case a
+ * message has been printed.
+ */
+ssize_t source_peek(source *s, char *buf, size_t len){
+    if (s->regular && s->fmt == FORMAT_PLAIN)
+    {
+        ssize_t n = pread(s->fd, buf, len, 0);
+        if (n < 0)
+        {
+            fprintf(stderr, "Failed to read map: %s\n", strerror(errno));
+        }
+        return n;
+    }
+    if (s->peek == NULL)
+    {
+        s->peek = check(alloc_malloc(ALLOC_LOADER, len));
+        ssize_t n;
+        while (s->peekLen < len &&
+               memchr(s->peek, '\n', s->peekLen) == NULL &&
+               (n = decode_read(s, s->peek + s->peekLen, len - s->peekLen)) != 0)
+        {
+            if (n < 0)
+            {
+                return -1;
+            }
+            s->peekLen += n;
+        }
+    }
+    size_t n = s->peekLen < len ? s->peekLen : len;
+    memcpy(buf, s->peek, n);
+    return n;
+}
+
+/**
+ * source_read() - Read the next bytes of the (decompressed) map.
+ * @s: Source to read from.
+ * @buf: Buffer receiving the bytes.
+ * @len: Size of buf.
+ *
+ * Returns: The number of bytes read, 0 at the end of the map or -1 on
+ * an error, in which case a message has been printed.
+ */
+ssize_t source_read(source *s, char *buf, size_t len){
+    if (s->peekPos < s->peekLen)
+    {
+        size_t n = s->peekLen - s->peekPos;
+        if (n > len)
+        {
+            n = len;
+        }
+        memcpy(buf, s->peek + s->peekPos, n);
+        s->peekPos += n;
+        return n;
+    }
+    return decode_read(s, buf, len);
+}
+
+/**
+ * source_close() - Destroy a source. The map file is not closed.
+ * @s: Source to destroy.
+ *
+ * Returns: Nothing.
+ */
+void source_close(source *s){
+#ifdef HAVE_ZLIB
+    if (s->fmt == FORMAT_GZIP)
+    {
+        inflateEnd(&s->z);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (s->fmt == FORMAT_ZSTD)
+    {
+        ZSTD_freeDStream(s->zstd);
+    }
+#endif
+    alloc_free(s->input);
+    alloc_free(s->peek);
+    alloc_free(s);
+}
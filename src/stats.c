@@ -0,0 +1,66 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+/*
+ * Implementation of the search counters used by is_connected.
+ */
+
+/**
+ * stats_now() - Read a monotonic clock.
+ *
+ * Returns: The current time in seconds.
+ */
+double stats_now(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * stats_reset() - Clear all counters.
+ * @s: Stats to clear.
+ *
+ * Returns: Nothing.
+ */
+void stats_reset(search_stats *s){
+    memset(s, 0, sizeof(*s));
+}
+
+/**
+ * stats_add() - Add the counters of one set of stats to another.
+ * @total: Stats to accumulate into.
+ * @s: Stats to add.
+ *
+ * The frontier peak of the total is the largest peak seen.
+ *
+ * Returns: Nothing.
+ */
+void stats_add(search_stats *total, const search_stats *s){
+    total->queries += s->queries;
+    total->nodes_visited += s->nodes_visited;
+    total->edges_relaxed += s->edges_relaxed;
+    total->allocations += s->allocations;
+    total->wall_time += s->wall_time;
+    if (s->frontier_peak > total->frontier_peak)
+    {
+        total->frontier_peak = s->frontier_peak;
+    }
+}
+
+/**
+ * stats_print() - Print a set of stats on one line.
+ * @out: Stream to print to.
+ * @label: Text printed in front of the counters.
+ * @s: Stats to print.
+ *
+ * Returns: Nothing.
+ */
+void stats_print(FILE *out, const char *label, const search_stats *s){
+    fprintf(out, "%s: queries=%lu visited=%lu edges=%lu frontier_peak=%lu "
+            "allocs=%lu time=%.6fs\n", label, s->queries, s->nodes_visited,
+            s->edges_relaxed, s->frontier_peak, s->allocations, s->wall_time);
+}
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "alloc.h"
+#include "strtab.h"
+
+/*
+ * Implementation of the string interning table. The slots hold ids into
+ * the names array and are kept at most half full; the table doubles
+ * when that limit is passed.
+ */
+
+struct strtab {
+    int *slots;        // Id stored in each slot, or -1 if free.
+    uint32_t *hashes;  // Hash of each interned string, indexed by id.
+    int *lengths;      // Length of each interned string, indexed by id.
+    char **names;      // Interned copies, indexed by id.
+    int mask;          // Number of slots minus one.
+    int size;          // Number of interned strings.
+    int capacity;      // Room in the id-indexed arrays.
+};
+
+/* FNV-1a hash of a string of given length. */
+static uint32_t hash(const char *s, int len)
+{
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Return the slot holding the string, or the free slot where it belongs. */
+static int find_slot(const strtab *t, const char *s, int len, uint32_t h)
+{
+    int i = h & t->mask;
+    while (t->slots[i] >= 0) {
+        int id = t->slots[i];
+        if (t->hashes[id] == h && t->lengths[id] == len &&
+            !memcmp(t->names[id], s, len)) {
+            return i;
+        }
+        i = (i + 1) & t->mask;
+    }
+    return i;
+}
+
+/* Double the number of slots and rehash all ids. */
+static void grow_slots(strtab *t)
+{
+    int slots = (t->mask + 1) * 2;
+    alloc_free(t->slots);
+    t->slots = check(alloc_malloc(ALLOC_LOADER, slots * sizeof(int)));
+    memset(t->slots, -1, slots * sizeof(int));
+    t->mask = slots - 1;
+    for (int id = 0; id < t->size; id++) {
+        int i = t->hashes[id] & t->mask;
+        while (t->slots[i] >= 0) {
+            i = (i + 1) & t->mask;
+        }
+        t->slots[i] = id;
+    }
+}
+
+/**
+ * strtab_empty() - Create an empty string table.
+ * @capacity: Expected number of strings, or 0 if not known.
+ *
+ * Returns: A pointer to the new table.
+ */
+strtab *strtab_empty(int capacity){
+    strtab *t = check(alloc_calloc(ALLOC_LOADER, 1, sizeof(*t)));
+    if (capacity < 16)
+    {
+        capacity = 16;
+    }
+    int slots = 1;
+    while (slots < 2 * capacity)
+    {
+        slots *= 2;
+    }
+    t->slots = check(alloc_malloc(ALLOC_LOADER, slots * sizeof(int)));
+    memset(t->slots, -1, slots * sizeof(int));
+    t->mask = slots - 1;
+    t->capacity = capacity;
+    t->hashes = check(alloc_malloc(ALLOC_LOADER, capacity * sizeof(uint32_t)));
+    t->lengths = check(alloc_malloc(ALLOC_LOADER, capacity * sizeof(int)));
+    t->names = check(alloc_malloc(ALLOC_LOADER, capacity * sizeof(char *)));
+    return t;
+}
+
+/**
+ * strtab_lookup() - Find the id of a string.
+ * @t: Table to search.
+ * @s: String to look for, need not be '\0'-terminated.
+ * @len: Length of s.
+ *
+ * Returns: The id of the string, or -1 if it has not been interned.
+ */
+int strtab_lookup(const strtab *t, const char *s, int len){
+    return t->slots[find_slot(t, s, len, hash(s, len))];
+}
+
+/**
+ * strtab_intern() - Find or add a string.
+ * @t: Table to modify.
+ * @s: String to intern, need not be '\0'-terminated.
+ * @len: Length of s.
+ * @added: Set to true if the string was new, otherwise false. May be NULL.
+ *
+ * Returns: The id of the string.
+ */
+int strtab_intern(strtab *t, const char *s, int len, bool *added){
+    uint32_t h = hash(s, len);
+    int i = find_slot(t, s, len, h);
+    if (added != NULL)
+    {
+        *added = t->slots[i] < 0;
+    }
+    if (t->slots[i] >= 0)
+    {
+        return t->slots[i];
+    }
+    // Make room in the id-indexed arrays
+    if (t->size == t->capacity)
+    {
+        t->capacity *= 2;
+        t->hashes = check(alloc_realloc(ALLOC_LOADER, t->hashes, t->capacity * sizeof(uint32_t)));
+        t->lengths = check(alloc_realloc(ALLOC_LOADER, t->lengths, t->capacity * sizeof(int)));
+        t->names = check(alloc_realloc(ALLOC_LOADER, t->names, t->capacity * sizeof(char *)));
+    }
+    int id = t->size++;
+    char *copy = check(alloc_malloc(ALLOC_LOADER, len + 1));
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+    t->names[id] = copy;
+    t->hashes[id] = h;
+    t->lengths[id] = len;
+    t->slots[i] = id;
+    // Keep the slots at most half full
+    if (2 * t->size > t->mask + 1)
+    {
+        grow_slots(t);
+    }
+    return id;
+}
+
+/**
+ * strtab_name() - Return the interned copy of a string.
+ * @t: Table to inspect.
+ * @id: Id of the string.
+ *
+ * Returns: The '\0'-terminated copy owned by the table.
+ */
+const char *strtab_name(const strtab *t, int id){
+    return t->names[id];
+}
+
+/**
+ * strtab_size() - Return the number of interned strings.
+ * @t: Table to inspect.
+ *
+ * Returns: The number of strings, which is also the next id.
+ */
+int strtab_size(const strtab *t){
+    return t->size;
+}
+
+/**
+ * strtab_kill() - Destroy a string table.
+ * @t: Table to destroy.
+ * @free_names: If false, the interned copies are left to the user.
+ *
+ * Returns: Nothing.
+ */
+void strtab_kill(strtab *t, bool free_names){
+    if (free_names)
+    {
+        for (int id = 0; id < t->size; id++)
+        {
+            alloc_free(t->names[id]);
+        }
+    }
+    alloc_free(t->slots);
+    alloc_free(t->hashes);
+    alloc_free(t->lengths);
+    alloc_free(t->names);
+    alloc_free(t);
+}
@@ -0,0 +1,83 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+/*
+ * Implementation of the Chrome trace-event writer. Only compiled in
+ * when TRACE is defined, see trace.h.
+ *
+ * Each event is written with a single fprintf() call, which stdio
+ * serializes, so spans may be emitted from several threads.
+ */
+
+#ifdef TRACE
+
+static FILE *trace_file = NULL;
+
+/* Return the monotonic time in microseconds. */
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * trace_open() - Start writing trace events to a file.
+ * @file: Name of the JSON file to create.
+ *
+ * Returns: True if the file could be created, otherwise false.
+ */
+bool trace_open(const char *file){
+    trace_file = fopen(file, "w");
+    if (trace_file == NULL)
+    {
+        return false;
+    }
+    fprintf(trace_file, "[\n");
+    return true;
+}
+
+/**
+ * trace_event() - Write one begin or end event.
+ * @name: Name of the span.
+ * @phase: 'B' to begin the span, 'E' to end it.
+ *
+ * Does nothing unless trace_open() has succeeded.
+ *
+ * Returns: Nothing.
+ */
+void trace_event(const char *name, char phase){
+    if (trace_file == NULL)
+    {
+        return;
+    }
+    fprintf(trace_file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,"
+            "\"pid\":%d,\"tid\":%ld},\n", name, phase, now_us(),
+            (int)getpid(), (long)syscall(SYS_gettid));
+}
+
+/**
+ * trace_close() - Finish the trace file.
+ *
+ * Returns: Nothing.
+ */
+void trace_close(void){
+    if (trace_file == NULL)
+    {
+        return;
+    }
+    // Close the array with a metadata event, so no event is followed
+    // by a dangling comma.
+    fprintf(trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+            "\"args\":{\"name\":\"is_connected\"}}\n]\n", (int)getpid());
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+#endif
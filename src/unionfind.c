@@ -0,0 +1,246 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "alloc.h"
+#include "strtab.h"
+#include "loader.h"
+#include "unionfind.h"
+
+/*
+ * Implementation of the union-find connectivity.
+ */
+
+// Bytes of the map read at a time.
+#define READ_SIZE (1 << 16)
+
+struct unionfind {
+    strtab *names;     // City names by index, NULL if built by index.
+    int *parent;       // parent[i] == i for the root of a set.
+    uint8_t *rank;     // Bound on the height of the tree under a root.
+    int capacity;
+    int numEdges;
+    int numSets;
+};
+
+/* Add element i as a set of its own, growing the arrays if needed. */
+static void add_set(unionfind *uf, int i)
+{
+    if (i == uf->capacity) {
+        uf->capacity = uf->capacity ? 2 * uf->capacity : 1024;
+        uf->parent = check(alloc_realloc(ALLOC_GRAPH, uf->parent,
+                                         uf->capacity * sizeof(*uf->parent)));
+        uf->rank = check(alloc_realloc(ALLOC_GRAPH, uf->rank, uf->capacity));
+    }
+    uf->parent[i] = i;
+    uf->rank[i] = 0;
+    uf->numSets++;
+}
+
+/* Return the index of a city, adding it as a set of its own if new. */
+static int add_city(unionfind *uf, const char *s, int len)
+{
+    bool added;
+    int i = strtab_intern(uf->names, s, len, &added);
+    if (added) {
+        add_set(uf, i);
+    }
+    return i;
+}
+
+/* Return the root of i's set, pointing the path there at the root. */
+static int find(unionfind *uf, int i, unsigned long *steps)
+{
+    int root = i;
+    while (uf->parent[root] != root) {
+        root = uf->parent[root];
+        (*steps)++;
+    }
+    while (uf->parent[i] != root) {
+        int next = uf->parent[i];
+        uf->parent[i] = root;
+        i = next;
+    }
+    return root;
+}
+
+/* Join the sets of a and b, returning false if they were the same. */
+static bool join(unionfind *uf, int a, int b)
+{
+    unsigned long steps = 0;
+    int x = find(uf, a, &steps);
+    int y = find(uf, b, &steps);
+    if (x == y) {
+        return false;
+    }
+    // The lower tree goes under the higher, so heights grow slowly
+    if (uf->rank[x] < uf->rank[y]) {
+        uf->parent[x] = y;
+    } else {
+        uf->parent[y] = x;
+        if (uf->rank[x] == uf->rank[y]) {
+            uf->rank[x]++;
+        }
+    }
+    uf->numSets--;
+    return true;
+}
+
+/* Edge callback: join the sets of the two cities. */
+static void join_cities(void *ctx, const char *a, int alen, const char *b, int blen)
+{
+    unionfind *uf = ctx;
+    int x = add_city(uf, a, alen);
+    join(uf, x, add_city(uf, b, blen));
+    uf->numEdges++;
+}
+
+/**
+ * unionfind_load() - Read a map into a union-find forest.
+ * @src: Source of the map bytes. Not closed.
+ *
+ * Lines are handled by the same rules as when the map is loaded into
+ * a graph.
+ *
+ * Returns: A pointer to the new forest, or NULL after printing an error
+ * message if the map is badly formatted.
+ */
+unionfind *unionfind_load(source *src){
+    unionfind *uf = check(alloc_calloc(ALLOC_GRAPH, 1, sizeof(unionfind)));
+    uf->names = strtab_empty(0);
+    if (!map_scan_source(src, READ_SIZE, join_cities, uf))
+    {
+        unionfind_kill(uf);
+        return NULL;
+    }
+    return uf;
+}
+
+/**
+ * unionfind_empty() - Create a forest of single element sets.
+ * @n: Number of elements, with the indices 0 to n-1.
+ *
+ * The forest has no names, so unionfind_lookup() must not be used.
+ *
+ * Returns: A pointer to the new forest.
+ */
+unionfind *unionfind_empty(int n){
+    unionfind *uf = check(alloc_calloc(ALLOC_GRAPH, 1, sizeof(unionfind)));
+    uf->capacity = n;
+    uf->parent = check(alloc_malloc(ALLOC_GRAPH, (n > 0 ? n : 1) * sizeof(*uf->parent)));
+    uf->rank = check(alloc_calloc(ALLOC_GRAPH, n > 0 ? n : 1, 1));
+    for (int i = 0; i < n; i++)
+    {
+        uf->parent[i] = i;
+    }
+    uf->numSets = n;
+    return uf;
+}
+
+/**
+ * unionfind_union() - Join the sets of two elements.
+ * @uf: Forest to modify.
+ * @a: Index of the first element.
+ * @b: Index of the second element.
+ *
+ * Returns: True if the elements were in different sets before.
+ */
+bool unionfind_union(unionfind *uf, int a, int b){
+    return join(uf, a, b);
+}
+
+/**
+ * unionfind_find() - Return the representative of the set of an element.
+ * @uf: Forest to inspect. Paths in it are compressed.
+ * @i: Index of the element.
+ *
+ * Returns: The index of the element representing the set.
+ */
+int unionfind_find(unionfind *uf, int i){
+    unsigned long steps = 0;
+    return find(uf, i, &steps);
+}
+
+/**
+ * unionfind_node_count() - Return the number of cities.
+ * @uf: Forest to inspect.
+ *
+ * Returns: The number of cities.
+ */
+int unionfind_node_count(const unionfind *uf){
+    return uf->names != NULL ? strtab_size(uf->names) : uf->capacity;
+}
+
+/**
+ * unionfind_edge_count() - Return the number of edges read from the map.
+ * @uf: Forest to inspect.
+ *
+ * Returns: The number of edges.
+ */
+int unionfind_edge_count(const unionfind *uf){
+    return uf->numEdges;
+}
+
+/**
+ * unionfind_set_count() - Return the number of connected parts.
+ * @uf: Forest to inspect.
+ *
+ * Returns: The number of sets.
+ */
+int unionfind_set_count(const unionfind *uf){
+    return uf->numSets;
+}
+
+/**
+ * unionfind_lookup() - Find a city by its name.
+ * @uf: Forest to inspect.
+ * @name: Name of the city.
+ *
+ * Returns: The index of the city, or -1 if there is no such city.
+ */
+int unionfind_lookup(const unionfind *uf, const char *name){
+    return strtab_lookup(uf->names, name, strlen(name));
+}
+
+/**
+ * unionfind_connected() - Check if two cities are connected.
+ * @uf: Forest to inspect. Paths in it are compressed.
+ * @from: Index of the origin city.
+ * @to: Index of the destination city.
+ * @stats: Counters for this query, or NULL if not wanted.
+ *
+ * The nodes visited count the steps taken towards the two roots. If
+ * stats is given it is overwritten with the cost of this query.
+ *
+ * Returns: True if the cities are in the same set.
+ */
+bool unionfind_connected(unionfind *uf, int from, int to, search_stats *stats){
+    search_stats st;
+    stats_reset(&st);
+    st.queries = 1;
+    double start = stats_now();
+    bool same = find(uf, from, &st.nodes_visited) == find(uf, to, &st.nodes_visited);
+    st.wall_time = stats_now() - start;
+    if (stats != NULL)
+    {
+        *stats = st;
+    }
+    return same;
+}
+
+/**
+ * unionfind_kill() - Destroy a forest.
+ * @uf: Forest to destroy.
+ *
+ * Returns: Nothing.
+ */
+void unionfind_kill(unionfind *uf){
+    if (uf->names != NULL)
+    {
+        strtab_kill(uf->names, true);
+    }
+    alloc_free(uf->parent);
+    alloc_free(uf->rank);
+    alloc_free(uf);
+}